@@ -2,47 +2,437 @@
 /* Copyright (c) 2024, Armin Biere, University of Freiburg, Germany       */
 /*------------------------------------------------------------------------*/
 
-static const char *usage = " usage : quienny[-h | -v][<input>[<output>]]\n";
+#ifndef LIBRARY
+static const char *usage =
+    "usage: quienny [ <option> ... ] [ <input> [ <output> ] ]\n"
+    "\n"
+    "where '<option>' is one of the following\n"
+    "\n"
+    "-h           print this command line option summary\n"
+    "-v           increase verbosity\n"
+    "-k <kernel>  force kernel '8', '16', '32', '64', '128', '256', '512'\n"
+    "             or 'generic' (default is the smallest one which fits)\n"
+    "-d <file>    read don't-care minterms or cubes from '<file>'\n"
+    "-t <threads> number of threads used for comparing monomials\n"
+    "-s <simd>    batch matching with 'avx512', 'avx2', 'neon', 'scalar'\n"
+    "             or 'none' (default is the best supported one)\n"
+    "-m <match>   match slices by comparing 'pairs', by 'lookup' of flipped\n"
+    "             monomials or 'auto'matically select cheaper (default)\n"
+    "-e <mbytes>  external memory mode keeping roughly at most that many\n"
+    "             megabytes of monomials in memory (spilling to '$TMPDIR')\n"
+    "-n <mode>    normalize by 'sort' (default), by 'hash'ing slices or\n"
+    "             by 'radix' sort (falls back to 'hash' for 'generic')\n"
+    "\n"
+    "--binary-in  read minterms (or cubes) in binary format\n"
+    "--binary-out write primes in binary format\n"
+    "--pipeline   normalize merged monomials of each block as soon as they\n"
+    "             are complete while matching the following blocks\n"
+    "--stream     write primes of each round as soon as it completes\n"
+    "             (sorted within rounds but not globally)\n"
+    "--consensus  compute primes of input cubes by iterated consensus\n"
+    "             (without expanding cubes into minterms)\n"
+    "--batch      read many functions (each terminated by an empty line)\n"
+    "             and compute their primes in parallel with '-t <threads>'\n"
+    "--cover      only write a small subset of primes covering all minterms\n"
+    "             (essential primes, dominance and greedy selection)\n"
+    "--stats      print statistics for each round to '<stderr>'\n"
+    "--stats-json <file>  write statistics for each round as JSON\n"
+    "\n"
+    "--time-limit <seconds>     abandon rounds after that much time\n"
+    "--memory-limit <megabytes> abandon rounds if using more memory\n"
+    "--partial <file>           write checkpoint of abandoned round\n"
+    "\n"
+    "--checkpoint <file>  save state after each round to '<file>'\n"
+    "--resume <file>      continue from checkpoint (instead of '<input>')\n"
+    "\n"
+    "Input lines are minterms or cubes with '-' for don't-care variables,\n"
+    "which are expanded into minterms (unless '--consensus' is used).\n"
+    "Primes which only cover don't-care minterms ('-d <file>') are not\n"
+    "printed.  Multi-output functions have a space and one character per\n"
+    "output after the cube ('1' if in the on-set of that output), and\n"
+    "their primes are printed with the outputs they are implicants of.\n"
+    "\n"
+    "If a limit is exceeded the primes of completed rounds are written and\n"
+    "the exit code is 2 for the time limit and 3 for the memory limit.\n"
+    "The checkpoint of an abandoned round ('--partial') can be resumed.\n"
+    "\n"
+    "The binary format starts with the eight byte header 'quienny1' followed\n"
+    "by the number of variables 'n' as 64-bit little endian number. Each\n"
+    "monomial consists of 'b' mask bytes followed by 'b' value bytes, with\n"
+    "'b = (n + 7) / 8' (but at least one) and variable 'i' as bit 'i % 8'\n"
+    "of byte 'i / 8'.  Unused bits and value bits of don't-cares are zero.\n";
+#endif
 
 /*------------------------------------------------------------------------*/
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cctype>
+#include <cinttypes>
 #include <climits>
+#include <condition_variable>
 #include <cstdarg>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 //------------------------------------------------------------------------//
 
 using namespace std;
 
 //------------------------------------------------------------------------//
 
-// Global input and output variables.
+// Input and output variables.  Files are only used by the command line
+// tool, while paths are also used in error messages by the library, and
+// thus like all options local to threads (see 'context' below).
 
 static FILE *input_file;
-static const char *input_path;
+static thread_local const char *input_path;
 static bool close_input;
 
 static FILE *output_file;
-static const char *output_path;
+static thread_local const char *output_path;
+#ifndef LIBRARY
 static bool close_output;
+#endif
+
+static void die(const char *, ...) __attribute__((format(printf, 1, 2)));
+static void verbose(const char *, ...) __attribute__((format(printf, 1, 2)));
+static void parse_error(const char *, ...)
+    __attribute__((format(printf, 1, 2)));
+
+//------------------------------------------------------------------------//
+
+// The instrumented binary 'quienny-profile' (built by 'make profile' with
+// '-DPROFILE') measures the time spent in each phase and, if permitted by
+// 'perf_event_open', also counts cycles, instructions, cache misses and
+// branch misses, printed to '<stderr>' at exit.  Phases are entered by
+// scoped 'profiled' objects around whole loops (never single comparisons).
+// The counters are only read when entering and leaving a scope and the
+// difference is charged to the innermost phase, thus nested phases are not
+// counted in the enclosing phase.  Each thread has its own counters, which
+// are added to the totals when the thread exits.  Without 'PROFILE' scopes
+// are empty and compiled away.
+
+enum phase {
+  PARSING,
+  MATCHING,
+  EXTRACTING,
+  NORMALIZING,
+  ITERATING, // Iterated consensus ('--consensus').
+  COVERING,
+  PRINTING,
+  PHASES
+};
+
+#ifdef PROFILE
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+
+static const char *phase_names[PHASES] = {
+    "parse", "match", "extract", "normalize", "consensus", "cover", "print"};
+
+static constexpr size_t events = 4; // Besides nanoseconds.
+
+struct profile {
+  uint64_t calls = 0;
+  uint64_t values[1 + events] = {}; // Nanoseconds first then events.
+};
+
+static mutex profiling;          // Protects 'profiles' and 'counted'.
+static profile profiles[PHASES]; // Totals of all threads.
+static bool counted;             // Hardware counters available.
+
+struct counters {
+  int fds[events];
+  int phase = -1; // Innermost phase entered (if any).
+  uint64_t last[1 + events];
+  profile local[PHASES];
+
+  counters() {
+    static const uint64_t configs[events] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (size_t i = 0; i != events; i++) {
+      perf_event_attr attr;
+      memset(&attr, 0, sizeof attr);
+      attr.size = sizeof attr;
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.exclude_kernel = attr.exclude_hv = 1;
+      const int leader = i ? fds[0] : -1;
+      fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+      if (fds[i] < 0) {
+        while (i--)
+          close(fds[i]);
+        fds[0] = -1;
+        break;
+      }
+    }
+    read(last);
+  }
+
+  ~counters() {
+    flush();
+    if (fds[0] >= 0)
+      for (auto fd : fds)
+        close(fd);
+  }
+
+  void read(uint64_t *values) const {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    values[0] = ts.tv_sec * (uint64_t)1000000000 + ts.tv_nsec;
+    struct {
+      uint64_t size, values[events];
+    } group;
+    if (fds[0] >= 0 && ::read(fds[0], &group, sizeof group) == sizeof group)
+      memcpy(values + 1, group.values, sizeof group.values);
+    else
+      memset(values + 1, 0, sizeof group.values);
+  }
+
+  void charge() {
+    uint64_t values[1 + events];
+    read(values);
+    if (phase >= 0)
+      for (size_t i = 0; i != 1 + events; i++)
+        local[phase].values[i] += values[i] - last[i];
+    memcpy(last, values, sizeof last);
+  }
+
+  void flush() {
+    lock_guard<mutex> guard(profiling);
+    for (size_t p = 0; p != PHASES; p++) {
+      profiles[p].calls += local[p].calls;
+      for (size_t i = 0; i != 1 + events; i++)
+        profiles[p].values[i] += local[p].values[i];
+      local[p] = profile();
+    }
+    counted |= fds[0] >= 0;
+  }
+};
+
+static thread_local counters counting;
+
+struct profiled {
+  const int saved;
+  profiled(phase p) : saved(counting.phase) {
+    counting.charge();
+    counting.phase = p;
+    counting.local[p].calls++;
+  }
+  ~profiled() {
+    counting.charge();
+    counting.phase = saved;
+  }
+};
+
+// Cache and branch misses are also given per thousand instructions.
+
+static void print_profile() {
+  counting.flush();
+  lock_guard<mutex> guard(profiling);
+  fprintf(stderr, "%-10s %8s %10s", "phase", "calls", "time");
+  if (counted)
+    fprintf(stderr, " %14s %14s %5s %13s %6s %13s %6s", "cycles",
+            "instructions", "ipc", "cache-misses", "mpki", "branch-misses",
+            "mpki");
+  fputc('\n', stderr);
+  for (size_t p = 0; p != PHASES; p++) {
+    const profile &f = profiles[p];
+    if (!f.calls)
+      continue;
+    fprintf(stderr, "%-10s %8" PRIu64 " %9.3fs", phase_names[p], f.calls,
+            1e-9 * f.values[0]);
+    if (counted) {
+      const double kilo = max(f.values[2], (uint64_t)1) / 1e3;
+      fprintf(stderr,
+              " %14" PRIu64 " %14" PRIu64 " %5.2f %13" PRIu64
+              " %6.2f %13" PRIu64 " %6.2f",
+              f.values[1], f.values[2],
+              f.values[2] / (double)max(f.values[1], (uint64_t)1),
+              f.values[3], f.values[3] / kilo, f.values[4],
+              f.values[4] / kilo);
+    }
+    fputc('\n', stderr);
+  }
+  if (!counted)
+    fputs("no hardware counters (see "
+          "'/proc/sys/kernel/perf_event_paranoid')\n",
+          stderr);
+}
+
+#else
+
+struct profiled {
+  profiled(phase) {}
+};
+
+static inline void print_profile() {}
+
+#endif
 
 /*------------------------------------------------------------------------*/
 
-static size_t lineno = 1;
+static thread_local size_t lineno = 1;
+
+static thread_local bool binary_input;  // Set by '--binary-in'.
+static thread_local bool binary_output; // Set by '--binary-out'.
+static thread_local size_t position; // Number of bytes read in binary input.
+static thread_local size_t offset;   // Start of the last binary record.
+
+// Input is either memory mapped if it is a regular file or otherwise read
+// in large chunks into a buffer, which is refilled (and enlarged for lines
+// longer than the buffer) as needed.  Characters in '[cursor, limit)' are
+// available without further reading.  With '--batch' each thread parses
+// its own part of the input, thus the cursor is local to threads.
+
+static thread_local const char *cursor, *limit; // Available characters.
+static vector<char> buffer;        // Used if the input is not mapped.
+static void *mapped;               // Start of the mapped input (if mapped).
+static size_t mapped_size;         // Size of mapped input.
+static thread_local bool exhausted; // All input has been read or mapped.
+
+// Minterms given as strings to the library engine are converted directly
+// instead (see 'parse_given').
+
+static thread_local const char *const *given, *const *given_end;
+
+static void init_reading() {
+  struct stat buf;
+  const int fd = fileno(input_file);
+  if (!fstat(fd, &buf) && S_ISREG(buf.st_mode) && buf.st_size > 0) {
+    void *start = mmap(0, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (start != MAP_FAILED) {
+      madvise(start, buf.st_size, MADV_SEQUENTIAL);
+      mapped = start, mapped_size = buf.st_size;
+      cursor = (const char *)start, limit = cursor + mapped_size;
+      exhausted = true;
+      return;
+    }
+  }
+  buffer.resize(1 << 20);
+  cursor = limit = buffer.data();
+}
+
+static void reset_reading() {
+  if (mapped)
+    munmap(mapped, mapped_size);
+  mapped = 0, mapped_size = 0;
+  cursor = limit = 0;
+  exhausted = false;
+  lineno = 1, position = offset = 0;
+}
+
+// Move the remaining characters to the start of the buffer and read more.
+// Returns 'false' if no more characters could be read.
+
+static bool refill() {
+  if (exhausted)
+    return false;
+  const size_t remaining = limit - cursor;
+  if (remaining == buffer.size())
+    buffer.resize(2 * buffer.size());
+  char *start = buffer.data();
+  memmove(start, cursor, remaining);
+  const size_t bytes =
+      fread(start + remaining, 1, buffer.size() - remaining, input_file);
+  if (!bytes)
+    exhausted = true;
+  cursor = start, limit = start + remaining + bytes;
+  return bytes;
+}
 
 static int read_char() {
-  int res = getc(input_file);
+  if (cursor == limit && !refill())
+    return EOF;
+  int res = (unsigned char)*cursor++;
   if (res == '\n')
     lineno++;
   return res;
 }
 
+// Make the next complete line (terminated by a new-line) available at
+// 'cursor' and return its length without the new-line.  Returns 'false' if
+// the input ends before the next new-line.
+
+static bool peek_line(size_t &length) {
+  size_t searched = 0;
+  for (;;) {
+    const char *start = cursor + searched;
+    const char *eol = (const char *)memchr(start, '\n', limit - start);
+    if (eol) {
+      length = eol - cursor;
+      return true;
+    }
+    searched = limit - cursor;
+    if (!refill())
+      return false;
+  }
+}
+
+static void skip_line(size_t length) {
+  cursor += length + 1;
+  lineno++;
+}
+
+// Read 'bytes' bytes of binary input and return a pointer to them, which
+// remains valid until the next read.  Returns zero at the end-of-file.
+
+static const unsigned char *read_bytes(size_t bytes) {
+  while ((size_t)(limit - cursor) < bytes && refill())
+    ;
+  if (cursor == limit)
+    return 0;
+  offset = position;
+  if ((size_t)(limit - cursor) < bytes)
+    parse_error("unexpected end-of-file (only %zu of %zu bytes)",
+                (size_t)(limit - cursor), bytes);
+  const unsigned char *res = (const unsigned char *)cursor;
+  cursor += bytes, position += bytes;
+  return res;
+}
+
+// Convert eight characters '0' or '1' at 'p' to a byte with the first
+// character as least significant bit.  Returns 'false' on other characters.
+
+static inline bool pack(const char *p, unsigned &byte) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint64_t chars;
+  memcpy(&chars, p, 8);
+  if ((chars & 0xfefefefefefefefeull) != 0x3030303030303030ull)
+    return false;
+  byte = ((chars & 0x0101010101010101ull) * 0x0102040810204080ull) >> 56;
+  return true;
+#else
+  byte = 0;
+  for (unsigned i = 0; i != 8; i++)
+    if (p[i] == '1')
+      byte |= 1u << i;
+    else if (p[i] != '0')
+      return false;
+  return true;
+#endif
+}
+
 //------------------------------------------------------------------------//
 
 // Represent the range of variables '[0, ..., n-1]'.
@@ -83,37 +473,73 @@ struct range {
   iterator end() { return iterator(size); }
 };
 
-static range variables;
+// Functions processed concurrently with '--batch' have different numbers
+// of variables, thus this is local to threads as well.
+
+static thread_local range variables;
+
+// Multi-output functions have a second column with one character per output
+// after the cube (separated by a space).  For single output functions this
+// is zero.
+
+static thread_local size_t outputs;
+
+static const size_t max_outputs = 32;
+
+// Number of characters of a printed monomial without the new-line.
+
+static size_t line_length() { return variables + (outputs ? outputs + 1 : 0); }
 
 //------------------------------------------------------------------------//
 
-static void die(const char *, ...) __attribute__((format(printf, 1, 2)));
-static void verbose(const char *, ...) __attribute__((format(printf, 1, 2)));
-static void parse_error(const char *, ...)
-    __attribute__((format(printf, 1, 2)));
+// The library ('-DLIBRARY') must not exit on errors.  Instead the message
+// is thrown as 'failure', which the engine turns into an error status.
+
+#ifdef LIBRARY
+struct failure {
+  string message;
+};
+#endif
+
+static void fatal(const char *prefix, const char *fmt, va_list ap) {
+#ifdef LIBRARY
+  char message[512];
+  vsnprintf(message, sizeof message, fmt, ap);
+  throw failure{string(prefix) + message};
+#else
+  fputs("quienny: ", stderr);
+  fputs(prefix, stderr);
+  vfprintf(stderr, fmt, ap);
+  fputc('\n', stderr);
+  exit(1);
+#endif
+}
 
 static void die(const char *fmt, ...) {
-  fputs("quienny: error: ", stderr);
   va_list ap;
   va_start(ap, fmt);
-  vfprintf(stderr, fmt, ap);
+  fatal("error: ", fmt, ap);
   va_end(ap);
-  fputc('\n', stderr);
-  exit(1);
 }
 
 static void parse_error(const char *fmt, ...) {
-  fprintf(stderr, "quienny: parse error: at line %zu in '%s': ", lineno,
-          input_path);
+  vector<char> prefix(strlen(input_path) + 64);
+  if (binary_input)
+    snprintf(prefix.data(), prefix.size(),
+             "parse error: at byte %zu in '%s': ", offset, input_path);
+  else if (given)
+    snprintf(prefix.data(), prefix.size(), "parse error: at minterm %zu: ",
+             lineno);
+  else
+    snprintf(prefix.data(), prefix.size(),
+             "parse error: at line %zu in '%s': ", lineno, input_path);
   va_list ap;
   va_start(ap, fmt);
-  vfprintf(stderr, fmt, ap);
+  fatal(prefix.data(), fmt, ap);
   va_end(ap);
-  fputc('\n', stderr);
-  exit(1);
 }
 
-static int verbosity;
+static thread_local int verbosity;
 
 static void verbose(const char *fmt, ...) {
   if (verbosity < 1)
@@ -128,23 +554,36 @@ static void verbose(const char *fmt, ...) {
 
 //------------------------------------------------------------------------//
 
-// We have two types of implementations of bitvectors used to store value
-// bits and the mask of valid bits.  The first is of fixed size and the type
-// given as argument to '-DFIXED=<type>' during compilation will determine
-// how many variables are available (for instance with '-DFIXED=unsigned' we
-// get '32 = 8 * 4' variables).  The second implementation uses a generic
-// implementation with 'vector<bool>', which is kind of compact, but uses
-// much more space per monomial than a plain word-based implementation and
-// is accordingly also much slower.
+// We have three types of implementations of bitvectors used to store value
+// bits and the mask of valid bits.  The first 'fixed<word>' is of fixed size
+// and the type 'word' given as template argument will determine how many
+// variables are available (for instance with 'fixed<uint32_t>' we get '32 =
+// 8 * 4' variables).  The second one 'words<W>' uses an array of 'W' 64-bit
+// words and thus allows '64 * W' variables (for instance 'words<2>' gives
+// 128 variables).  The third implementation 'generic' uses a vector of
+// words, with their number only known at run-time, which needs a heap
+// allocation per bit-vector (taken from a pool though) and is accordingly
+// slower than the other ones.
 
-#ifdef FIXED
+// All three are used as template argument for monomials, polynomials and
+// the 'generate' function and the 'main' function picks the narrowest one
+// after parsing the first monomial (unless forced with '-k <kernel>').
 
-#include <cstdint> // Allows to use 'uint32_t' for FIXED.
+// Besides access functions each bitvector provides 'match', which checks
+// whether 'other' differs in exactly one bit.  If this is the case its
+// position is returned in 'where'.  That is the core of 'monomial::match'.
+// Cube operations ('--consensus') go over the 'width' words with 'get_word'
+// and 'set_word' (bits beyond the variables are kept zero).
 
-typedef FIXED word;
-
-struct bitvector {
+template <typename word> struct fixed {
   word bits = 0;
+  static const size_t max_variables = 8 * sizeof(word);
+  static const size_t bytes = sizeof(word);
+  unsigned byte(const size_t i) const { return (bits >> (8 * i)) & 255; }
+  void set_byte(const size_t i, unsigned byte) {
+    const word mask = (word)((word)255 << (8 * i));
+    bits = (bits & ~mask) | (word)((word)byte << (8 * i));
+  }
   bool get(const size_t i) const { return bits & ((word)1 << i); }
   void set(const size_t i, bool value) {
     word mask = (word)1 << i;
@@ -152,59 +591,345 @@ struct bitvector {
     bits = (bits & ~mask) | bit;
   }
   void add(const size_t i, bool value) { set(i, value); }
-  bool operator!=(const bitvector &other) const { return bits != other.bits; }
-  bool operator==(const bitvector &other) const { return bits == other.bits; }
-  bool operator<(const bitvector &other) const { return bits > other.bits; }
-  bool operator>(const bitvector &other) const { return bits < other.bits; }
+  size_t width() const { return 1; }
+  uint64_t get_word(const size_t) const { return bits; }
+  void set_word(const size_t, uint64_t w) { bits = (word)w; }
+  bool operator!=(const fixed &other) const { return bits != other.bits; }
+  bool operator==(const fixed &other) const { return bits == other.bits; }
+  bool operator<(const fixed &other) const { return bits > other.bits; }
+  bool operator>(const fixed &other) const { return bits < other.bits; }
   // LSB comes first in the input and output. Thus we need to reverse order.
+  size_t hash() const { return bits; }
+  size_t count() const { return __builtin_popcountll(bits); }
+  bool all_set_below(const size_t i) const {
+    const word below = (word)(((word)1 << i) - 1);
+    return (bits & below) == below;
+  }
+  bool match(const fixed &other, size_t &where) const {
+    // The fixed bit-vector version can use bit-twiddling hacks.
+    const word difference = bits ^ other.bits;
+    if (difference & (difference - 1)) // Not power-of two?
+      return false;
+    assert(difference); // Normalization makes them all different.
+    where = __builtin_ctzll(difference);
+    return true;
+  }
 };
 
-const size_t max_variables = 8 * sizeof(word);
+template <size_t W> struct words {
+  static const size_t word_bits = 64;
+  array<uint64_t, W> bits = {};
+  static const size_t max_variables = word_bits * W;
+  static const size_t bytes = 8 * W;
+  unsigned byte(const size_t i) const {
+    return (bits[i / 8] >> (8 * (i % 8))) & 255;
+  }
+  void set_byte(const size_t i, unsigned byte) {
+    uint64_t &w = bits[i / 8];
+    const uint64_t mask = (uint64_t)255 << (8 * (i % 8));
+    w = (w & ~mask) | (uint64_t)byte << (8 * (i % 8));
+  }
+  bool get(const size_t i) const {
+    return bits[i / word_bits] & ((uint64_t)1 << (i % word_bits));
+  }
+  void set(const size_t i, bool value) {
+    uint64_t &w = bits[i / word_bits];
+    uint64_t mask = (uint64_t)1 << (i % word_bits);
+    uint64_t bit = (uint64_t)value << (i % word_bits);
+    w = (w & ~mask) | bit;
+  }
+  void add(const size_t i, bool value) { set(i, value); }
+  size_t width() const { return W; }
+  uint64_t get_word(const size_t i) const { return bits[i]; }
+  void set_word(const size_t i, uint64_t w) { bits[i] = w; }
+  bool operator!=(const words &other) const { return bits != other.bits; }
+  bool operator==(const words &other) const { return bits == other.bits; }
+  // Same reversed order as for a single word, i.e., the most significant
+  // word is compared first and words are compared with '>'.
+  bool operator<(const words &other) const {
+    for (size_t i = W; i--;)
+      if (bits[i] != other.bits[i])
+        return bits[i] > other.bits[i];
+    return false;
+  }
+  bool operator>(const words &other) const { return other < *this; }
+  size_t hash() const {
+    size_t res = 0;
+    for (auto w : bits)
+      res = (res ^ w) * 0x9e3779b97f4a7c15ull;
+    return res;
+  }
+  size_t count() const {
+    size_t res = 0;
+    for (auto w : bits)
+      res += __builtin_popcountll(w);
+    return res;
+  }
+  bool all_set_below(const size_t i) const {
+    for (size_t j = 0; j != i / word_bits; j++)
+      if (~bits[j])
+        return false;
+    const uint64_t below = ((uint64_t)1 << (i % word_bits)) - 1;
+    return (bits[i / word_bits] & below) == below;
+  }
+  bool match(const words &other, size_t &where) const {
+    // The multi-word version requires that exactly one word differs and
+    // this difference has to be a power of two (a single set bit).
+    bool matched = false;
+    for (size_t i = 0; i != W; i++) {
+      const uint64_t difference = bits[i] ^ other.bits[i];
+      if (!difference)
+        continue;
+      if (matched)
+        return false;
+      if (__builtin_popcountll(difference) != 1)
+        return false;
+      matched = true;
+      where = i * word_bits + __builtin_ctzll(difference);
+    }
+    assert(matched); // Normalization makes them all different.
+    return matched;
+  }
+};
 
-#else
+// All 'generic' bit-vectors of a run have the same number of words and
+// are copied all the time while adding and sorting monomials.  Instead of
+// going through 'malloc' for each of them they are taken from a pool of
+// large chunks with a free list per thread.  Other sizes (only occurring
+// while parsing the first monomial) are allocated as usual.  The chunks
+// belong to the run (the command line tool or a library engine), are
+// shared by its threads and released at the very end (or after each call
+// of the library).
 
-struct bitvector {
-  vector<bool> bits;
-  bool get(const size_t i) const { return bits[i]; }
-  void set(const size_t i, bool value) { bits[i] = value; };
-  void add(const size_t, bool value) { bits.push_back(value); }
-  bool operator!=(const bitvector &other) const { return bits != other.bits; }
-  bool operator==(const bitvector &other) const { return bits == other.bits; }
-  bool operator<(const bitvector &other) const { return bits < other.bits; }
-  bool operator>(const bitvector &other) const { return bits > other.bits; }
+struct pool {
+  static thread_local size_t bytes; // Size of pooled blocks (zero if none).
+  static thread_local vector<void *> *chunks; // Allocated chunks of run.
+  static mutex lock;                          // Protects all 'chunks'.
+  static thread_local void *free_list;
+  static thread_local char *top, *limit;
+  static constexpr size_t chunk = 1 << 16;
+  static void *allocate(size_t n) {
+    if (n != bytes)
+      return ::operator new(n);
+    if (void *res = free_list) {
+      free_list = *(void **)res;
+      return res;
+    }
+    if ((size_t)(limit - top) < n) {
+      const size_t size = max(chunk, n);
+      top = (char *)::operator new(size), limit = top + size;
+      lock_guard<mutex> guard(lock);
+      chunks->push_back(top);
+    }
+    void *res = top;
+    top += n;
+    return res;
+  }
+  static void deallocate(void *p, size_t n) {
+    if (n != bytes)
+      ::operator delete(p);
+    else
+      *(void **)p = free_list, free_list = p;
+  }
+  static void init(size_t n, vector<void *> &c) {
+    bytes = max(n, sizeof(void *)), chunks = &c;
+  }
+  static void reset() {
+    if (chunks) {
+      for (auto c : *chunks)
+        ::operator delete(c);
+      chunks->clear();
+    }
+    bytes = 0, chunks = 0, free_list = 0, top = limit = 0;
+  }
 };
 
-const size_t max_variables = ~(size_t)0;
+thread_local size_t pool::bytes;
+thread_local vector<void *> *pool::chunks;
+mutex pool::lock;
+thread_local void *pool::free_list;
+thread_local char *pool::top, *pool::limit;
 
-#endif
+template <class T> struct pooled {
+  typedef T value_type;
+  pooled() {}
+  template <class U> pooled(const pooled<U> &) {}
+  T *allocate(size_t n) { return (T *)pool::allocate(n * sizeof(T)); }
+  void deallocate(T *p, size_t n) { pool::deallocate(p, n * sizeof(T)); }
+  bool operator==(const pooled &) const { return true; }
+  bool operator!=(const pooled &) const { return false; }
+};
+
+struct generic {
+  static const size_t word_bits = 64;
+  vector<uint64_t, pooled<uint64_t>> bits;
+  static const size_t max_variables = ~(size_t)0;
+  static const size_t bytes = 0; // No radix sort.
+  bool get(const size_t i) const {
+    return bits[i / word_bits] & ((uint64_t)1 << (i % word_bits));
+  }
+  void set(const size_t i, bool value) {
+    uint64_t &w = bits[i / word_bits];
+    uint64_t mask = (uint64_t)1 << (i % word_bits);
+    uint64_t bit = (uint64_t)value << (i % word_bits);
+    w = (w & ~mask) | bit;
+  }
+  void add(const size_t i, bool value) {
+    if (!(i % word_bits))
+      bits.push_back(0);
+    set(i, value);
+  }
+  void resize(const size_t size) {
+    bits.resize((size + word_bits - 1) / word_bits);
+  }
+  size_t width() const { return bits.size(); }
+  uint64_t get_word(const size_t i) const { return bits[i]; }
+  void set_word(const size_t i, uint64_t w) { bits[i] = w; }
+  bool operator!=(const generic &other) const { return bits != other.bits; }
+  bool operator==(const generic &other) const { return bits == other.bits; }
+  // Use the same reversed order as the word based versions, which makes
+  // the output independent of the chosen kernel.
+  bool operator<(const generic &other) const {
+    for (size_t i = bits.size(); i--;)
+      if (bits[i] != other.bits[i])
+        return bits[i] > other.bits[i];
+    return false;
+  }
+  bool operator>(const generic &other) const { return other < *this; }
+  size_t hash() const {
+    size_t res = 0;
+    for (auto w : bits)
+      res = (res ^ w) * 0x9e3779b97f4a7c15ull;
+    return res;
+  }
+  size_t count() const {
+    size_t res = 0;
+    for (auto w : bits)
+      res += __builtin_popcountll(w);
+    return res;
+  }
+  bool all_set_below(const size_t i) const {
+    for (size_t j = 0; j != i / word_bits; j++)
+      if (~bits[j])
+        return false;
+    const uint64_t below = ((uint64_t)1 << (i % word_bits)) - 1;
+    return (bits[i / word_bits] & below) == below;
+  }
+  bool match(const generic &other, size_t &where) const {
+    // Same as for 'words' but with the number of words only known at
+    // run-time.
+    bool matched = false;
+    for (size_t i = 0; i != bits.size(); i++) {
+      const uint64_t difference = bits[i] ^ other.bits[i];
+      if (!difference)
+        continue;
+      if (matched)
+        return false;
+      if (__builtin_popcountll(difference) != 1)
+        return false;
+      matched = true;
+      where = i * word_bits + __builtin_ctzll(difference);
+    }
+    assert(matched); // Normalization makes them all different.
+    return matched;
+  }
+};
 
 //------------------------------------------------------------------------//
 
 // A monomial consists of a bit-vector of 'values' masked by 'mask'.  Only
 // value bits which have a corresponding mask bit set are valid.  The others
-// are invalid, thus "don't cares" ('-').
+// are invalid, thus "don't cares" ('-').  Invalid value bits are always kept
+// zero, which allows to compare masks and values directly.
+
+// Monomials obtained only from don't-care minterms ('-d <file>') have 'care'
+// cleared.  They take part in merging but are never printed as primes.  The
+// flag shares the word of 'ones' and is ignored by comparisons.
 
-struct monomial {
-  size_t ones = 0;
+// For multi-output functions 'tags' has bit 'k' set if the monomial is an
+// implicant of output 'k'.  Single output functions have all 'tags' one.
+// The tags share the word of 'ones' too, which limits 'ones' to 31 bits.
+
+template <class bitvector> struct monomial {
+  size_t ones : 31;
+  size_t care : 1;  // Covers an on-set minterm (not only don't-cares).
+  size_t tags : 32; // Outputs of which the monomial is an implicant.
   bitvector mask;
   bitvector values;
+  monomial() : ones(0), care(1), tags(1) {}
+  template <class other> explicit monomial(const monomial<other> &);
   void debug() const;
-  void print(FILE *) const;
+  void print(char *) const;
   bool parse_first();
+  void parse_outputs();
+  bool parse_tags(const char *);
   bool parse_remaining();
+  bool parse_binary();
+  bool parse_given(bool first);
+  void decode(const unsigned char *);
+  void encode(unsigned char *) const;
   bool operator==(const monomial &) const;
   bool operator!=(const monomial &other) const { return !(*this == other); }
   bool operator<(const monomial &) const;
   bool match(const monomial &, size_t &where) const;
+  bool contains(const monomial &) const;
+  bool intersects(const monomial &) const;
+  bool consensus(const monomial &, monomial &res) const;
 };
 
-void monomial::print(FILE *file) const {
-  for (auto i : variables)
-    fputc(mask.get(i) ? '0' + values.get(i) : '-', file);
-  fputc('\n', file);
+// Convert a monomial (usually the first parsed 'generic' one) to another
+// bit-vector representation.
+
+template <class bitvector>
+template <class other>
+monomial<bitvector>::monomial(const monomial<other> &m)
+    : ones(m.ones), care(m.care), tags(m.tags) {
+  for (auto i : variables) {
+    mask.add(i, m.mask.get(i));
+    values.add(i, m.values.get(i));
+  }
+}
+
+// Spread the eight bits of a byte to the least significant bits of the
+// eight bytes of a word (first bit to first byte in memory order).
+
+static const array<uint64_t, 256> spread = []() {
+  array<uint64_t, 256> res = {};
+  for (unsigned byte = 0; byte != 256; byte++)
+    for (unsigned i = 0; i != 8; i++)
+      if (byte & (1u << i))
+        res[byte] |= (uint64_t)1 << (8 * i);
+  return res;
+}();
+
+// Print the monomial as a line of 'variables' characters (and its outputs)
+// followed by a new-line into 'chars'.  Word based bit-vectors are
+// formatted eight characters at a time, since with '-' for cleared mask
+// bits and zero value bits for don't-cares each character is '-' plus three
+// times the mask bit plus the value bit.
+
+template <class bitvector> void monomial<bitvector>::print(char *chars) const {
+  size_t i = 0;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if constexpr (bitvector::bytes != 0)
+    for (; i + 8 <= variables; i += 8) {
+      const uint64_t dashes = 0x2d2d2d2d2d2d2d2dull;
+      const uint64_t word =
+          dashes + 3 * spread[mask.byte(i / 8)] + spread[values.byte(i / 8)];
+      memcpy(chars + i, &word, 8);
+    }
+#endif
+  for (; i != variables; i++)
+    chars[i] = mask.get(i) ? '0' + values.get(i) : '-';
+  if (outputs) {
+    chars[i++] = ' ';
+    for (size_t k = 0; k != outputs; k++)
+      chars[i++] = '0' + ((tags >> k) & 1);
+  }
+  chars[i] = '\n';
 }
 
-void monomial::debug() const {
+template <class bitvector> void monomial<bitvector>::debug() const {
   fprintf(stderr, "%zu:", ones);
   for (auto i : variables)
     fputc(mask.get(i) + '0', stderr);
@@ -213,29 +938,147 @@ void monomial::debug() const {
     fputc(values.get(i) + '0', stderr);
 }
 
+// In the binary format each bit-vector takes 'binary_bytes' bytes and the
+// number of variables is given in the header instead of being determined
+// by the length of the first monomial.
+
+static const char binary_magic[8] = {'q', 'u', 'i', 'e', 'n', 'n', 'y', '1'};
+
+static size_t binary_bytes() { return max((variables + 7) / 8, (size_t)1); }
+
+// Numbers in headers are stored as 64-bit little endian numbers.
+
+static uint64_t decode_number(const unsigned char *bytes) {
+  uint64_t res = 0;
+  for (unsigned i = 8; i--;)
+    res = (res << 8) | bytes[i];
+  return res;
+}
+
+static void encode_number(uint64_t n, unsigned char *bytes) {
+  for (unsigned i = 0; i != 8; i++, n >>= 8)
+    bytes[i] = n & 255;
+}
+
+static void parse_variables(const unsigned char *bytes) {
+  const uint64_t n = decode_number(bytes);
+  if (n >> 32)
+    parse_error("too many variables '%" PRIu64 "' in binary header", n);
+  variables.size = n;
+}
+
+static void parse_binary_header() {
+  const unsigned char *header = read_bytes(16);
+  if (!header)
+    parse_error("unexpected end-of-file (expected binary header)");
+  if (memcmp(header, binary_magic, sizeof binary_magic))
+    parse_error("invalid binary header (try '-h')");
+  parse_variables(header + 8);
+}
+
+static void print_binary_header(FILE *file) {
+  unsigned char header[16];
+  memcpy(header, binary_magic, sizeof binary_magic);
+  encode_number(variables, header + 8);
+  fwrite(header, 1, sizeof header, file);
+}
+
+// Write 'binary_bytes' mask bytes followed by as many value bytes.
+
+template <class bitvector>
+void monomial<bitvector>::encode(unsigned char *bytes) const {
+  const size_t n = binary_bytes();
+  if constexpr (bitvector::bytes != 0) {
+    for (size_t j = 0; j != n; j++)
+      bytes[j] = mask.byte(j), bytes[n + j] = values.byte(j);
+  } else {
+    memset(bytes, 0, 2 * n);
+    for (auto i : variables) {
+      bytes[i / 8] |= mask.get(i) << (i % 8);
+      bytes[n + i / 8] |= values.get(i) << (i % 8);
+    }
+  }
+}
+
+// Parse a binary monomial (a minterm or a cube with don't-cares).
+
+template <class bitvector> bool monomial<bitvector>::parse_binary() {
+  const size_t n = binary_bytes();
+  const unsigned char *bytes = read_bytes(2 * n);
+  if (!bytes)
+    return false;
+  for (size_t j = 0; j != n; j++) {
+    unsigned expected = 255;
+    if (8 * j + 8 > variables)
+      expected = (1u << (variables - 8 * j)) - 1;
+    if (bytes[j] & ~expected)
+      parse_error("mask bits set beyond %zu variables", (size_t)variables);
+    if (bytes[n + j] & ~bytes[j])
+      parse_error("value bits set for don't-cares or beyond %zu variables",
+                  (size_t)variables);
+  }
+  decode(bytes);
+  return true;
+}
+
+// Inverse of 'encode' (without checking the bytes).
+
+template <class bitvector>
+void monomial<bitvector>::decode(const unsigned char *bytes) {
+  const size_t n = binary_bytes();
+  if constexpr (bitvector::bytes != 0) {
+    for (size_t j = 0; j != n; j++)
+      mask.set_byte(j, bytes[j]), values.set_byte(j, bytes[n + j]);
+  } else {
+    mask.resize(variables), values.resize(variables);
+    for (auto i : variables) {
+      mask.set(i, (bytes[i / 8] >> (i % 8)) & 1);
+      values.set(i, (bytes[n + i / 8] >> (i % 8)) & 1);
+    }
+  }
+  ones = values.count();
+}
+
 // Parsing the first monomial in the 'input' file also sets the range of
 // variables.  The function returns 'false' if end-of-file is found instead.
 
-bool monomial::parse_first() {
+template <class bitvector> bool monomial<bitvector>::parse_first() {
+  if (given)
+    return parse_given(true);
+  if (binary_input) {
+    parse_binary_header();
+    for (auto i : variables)
+      mask.add(i, true), values.add(i, false);
+    return parse_binary();
+  }
   int ch = read_char();
   if (ch == EOF)
     return false;
   while (ch != '\n') {
-    bool value = false;
+    if (ch == ' ') {
+      parse_outputs();
+      break;
+    }
+    bool value = false, valid = true;
     if (ch == '1')
       value = true;
+    else if (ch == '-')
+      valid = false;
     else if (ch != '0') {
       if (ch == EOF)
-        parse_error("unexpected end-of-file (expected '0' or '1' or new-line)");
+        parse_error(
+            "unexpected end-of-file (expected '0', '1', '-' or new-line)");
       else if (isprint(ch))
-        parse_error("expected '0' or '1' or new-line at '%c'", ch);
+        parse_error("expected '0', '1', '-' or new-line at '%c'", ch);
       else
-        parse_error("expected '0' or '1' or new-line at caracter code '0x%02x'",
-                    ch);
-    } else if (variables == max_variables)
+        parse_error(
+            "expected '0', '1', '-' or new-line at caracter code '0x%02x'",
+            ch);
+    }
+    if (variables == bitvector::max_variables)
       parse_error("monomial too large");
     values.add(variables, value);
-    mask.add(variables, true);
+    mask.add(variables, valid);
     ones += value;
     ch = read_char();
     variables++;
@@ -243,36 +1086,148 @@ bool monomial::parse_first() {
   return true;
 }
 
+// The outputs of the first monomial after the space determine the number of
+// outputs.  Characters '0' and '-' both mean that the cube is not part of
+// the on-set of that output (as in PLA files of type 'f').
+
+static void check_outputs();
+
+template <class bitvector> void monomial<bitvector>::parse_outputs() {
+  check_outputs();
+  tags = 0;
+  int ch;
+  while ((ch = read_char()) != '\n') {
+    if (ch == '1')
+      tags |= (size_t)1 << outputs;
+    else if (ch != '0' && ch != '-') {
+      if (ch == EOF)
+        parse_error("unexpected end-of-file (expected '0', '1', '-' or "
+                    "new-line)");
+      else if (isprint(ch))
+        parse_error("expected output '0', '1', '-' or new-line at '%c'", ch);
+      else
+        parse_error("expected output '0', '1', '-' or new-line at caracter "
+                    "code '0x%02x'",
+                    ch);
+    }
+    if (outputs == max_outputs)
+      parse_error("more than %zu outputs", max_outputs);
+    outputs++;
+  }
+  if (!outputs) {
+    lineno--;
+    parse_error("no outputs after space");
+  }
+}
+
+// Parse the output characters of the remaining monomials at 'p' into 'tags'
+// and return 'false' on unexpected characters.
+
+template <class bitvector> bool monomial<bitvector>::parse_tags(const char *p) {
+  tags = 0;
+  for (size_t k = 0; k != outputs; k++)
+    if (p[k] == '1')
+      tags |= (size_t)1 << k;
+    else if (p[k] != '0' && p[k] != '-')
+      return false;
+  return true;
+}
+
 // Parsing the remaining monomial in the 'input' file after parsing the first
 // one. These monomials need to have the size of the 'first' parsed monomial.
 // The function returns 'false' if the end-of-file is reached.
 
-bool monomial::parse_remaining() {
+template <class bitvector> bool monomial<bitvector>::parse_remaining() {
+
+  if (given)
+    return parse_given(false);
+
+  if (binary_input)
+    return parse_binary();
+
+  // For word based bit-vectors we first try to parse a complete line of
+  // the expected length eight characters at a time.  If this fails, the
+  // character based code below parses cubes or produces the proper error
+  // message.
+
+  if constexpr (bitvector::bytes != 0) {
+    size_t length;
+    if (peek_line(length) && length == line_length()) {
+      const size_t bytes = variables / 8;
+      bool valid = true;
+      unsigned byte;
+      for (size_t i = 0; valid && i != bytes; i++)
+        if ((valid = pack(cursor + 8 * i, byte)))
+          values.set_byte(i, byte), mask.set_byte(i, 255);
+      for (size_t i = 8 * bytes; valid && i != variables; i++) {
+        const char ch = cursor[i];
+        if ((valid = (ch == '0' || ch == '1')))
+          values.set(i, ch == '1'), mask.set(i, true);
+      }
+      if (valid && outputs)
+        valid = cursor[variables] == ' ' && parse_tags(cursor + variables + 1);
+      if (valid) {
+        ones = values.count();
+        skip_line(length);
+        return true;
+      }
+    }
+  }
+
   int ch = read_char();
   if (ch == EOF)
     return false;
   ones = 0;
   for (auto i : variables) {
-    bool value = false;
+    bool value = false, valid = true;
     if (ch == '1')
       value = true;
+    else if (ch == '-')
+      valid = false;
     else if (ch != '0') {
       if (ch == EOF)
-        parse_error("unexpected end-of-file (expected '0' or '1')");
+        parse_error("unexpected end-of-file (expected '0', '1' or '-')");
       else if (ch == '\n') {
         assert(lineno > 1);
         lineno--;
-        parse_error("unexpected new-line (expected '0' or '1')");
+        parse_error("unexpected new-line (expected '0', '1' or '-')");
       } else if (isprint(ch))
-        parse_error("expected '0' or '1' at '%c'", ch);
+        parse_error("expected '0', '1' or '-' at '%c'", ch);
       else
-        parse_error("expected '0' or '1' at caracter code '0x%02x'", ch);
+        parse_error("expected '0', '1' or '-' at caracter code '0x%02x'", ch);
     }
     values.set(i, value);
-    mask.set(i, true);
+    mask.set(i, valid);
     ones += value;
     ch = read_char();
   }
+  if (outputs) {
+    if (ch != ' ') {
+      if (ch == '\n')
+        lineno--;
+      parse_error("expected space before outputs");
+    }
+    tags = 0;
+    for (size_t k = 0; k != outputs; k++) {
+      ch = read_char();
+      if (ch == '1')
+        tags |= (size_t)1 << k;
+      else if (ch != '0' && ch != '-') {
+        if (ch == EOF)
+          parse_error("unexpected end-of-file (expected output)");
+        else if (ch == '\n') {
+          lineno--;
+          parse_error("unexpected new-line (expected output)");
+        } else if (isprint(ch))
+          parse_error("expected output '0', '1' or '-' at '%c'", ch);
+        else
+          parse_error("expected output '0', '1' or '-' at caracter code "
+                      "'0x%02x'",
+                      ch);
+      }
+    }
+    ch = read_char();
+  }
   if (ch != '\n') {
     if (ch == EOF)
       parse_error("unexpected end-of-file (expected new-line)");
@@ -284,22 +1239,70 @@ bool monomial::parse_remaining() {
   return true;
 }
 
-bool monomial::operator==(const monomial &other) const {
-  if (mask != other.mask)
+// The strings given to the library engine are the lines of the input
+// without new-line.  As with 'parse_first' the first string determines the
+// number of variables (and outputs), and 'lineno' counts strings.
+
+template <class bitvector> bool monomial<bitvector>::parse_given(bool first) {
+  if (given == given_end)
     return false;
-  for (auto i : variables)
-    if (mask.get(i) && values.get(i) != other.values.get(i))
-      return false;
+  const char *p = *given++;
+  lineno++;
+  const size_t length = strlen(p);
+  const char *space = (const char *)memchr(p, ' ', length);
+  const size_t n = space && (first || outputs) ? space - p : length;
+  if (!first && n != variables)
+    parse_error("expected %zu variables but got %zu", (size_t)variables, n);
+  ones = 0;
+  for (size_t i = 0; i != n; i++) {
+    const char ch = p[i];
+    if (ch != '0' && ch != '1' && ch != '-') {
+      if (isprint(ch))
+        parse_error("expected '0', '1' or '-' at '%c'", ch);
+      else
+        parse_error("expected '0', '1' or '-' at caracter code '0x%02x'",
+                    (unsigned char)ch);
+    }
+    if (first) {
+      if (variables == bitvector::max_variables)
+        parse_error("monomial too large");
+      values.add(i, ch == '1'), mask.add(i, ch != '-');
+      variables++;
+    } else
+      values.set(i, ch == '1'), mask.set(i, ch != '-');
+    ones += ch == '1';
+  }
+  if (first && space) {
+    check_outputs();
+    if (!(outputs = length - n - 1))
+      parse_error("no outputs after space");
+    if (outputs > max_outputs)
+      parse_error("more than %zu outputs", max_outputs);
+  }
+  if (outputs) {
+    if (!space)
+      parse_error("expected space before outputs");
+    if (length - n - 1 != outputs)
+      parse_error("expected %zu outputs but got %zu", outputs, length - n - 1);
+    if (!parse_tags(space + 1))
+      parse_error("expected outputs '0', '1' or '-'");
+  }
   return true;
 }
 
-// The less-than operator '<' is used to sort and normalize the polynomial.
+template <class bitvector>
+bool monomial<bitvector>::operator==(const monomial &other) const {
+  return mask == other.mask && values == other.values;
+}
+
+// The less-than operator '<' is used to sort and normalize the polynomial.
 // Sorting is first done with respect to the number of (valid) '1' bits
 // 'ones', then with respect to the 'mask' , and finally the 'values'.
 
 // This order is required for the optimized algorithm to work.
 
-bool monomial::operator<(const monomial &other) const {
+template <class bitvector>
+bool monomial<bitvector>::operator<(const monomial &other) const {
   if (ones < other.ones)
     return true;
   if (ones > other.ones)
@@ -312,14 +1315,13 @@ bool monomial::operator<(const monomial &other) const {
 }
 
 // Check whether the 'other' monomial differs in exactly one valid bit. If this
-// is the case the result parameter 'where' is set to that bit position.  We
-// specialize this for the fixed maximum variable sizes and therefore have
-// two versions of the code (one with '#ifddef FIXED ... #else' and one for
-// the general case withing '#else ... #endif').
+// is the case the result parameter 'where' is set to that bit position.  The
+// actual check is specialized for each type of bit-vector.
 
-static size_t compared; // Number of compared monomials.
+static thread_local size_t compared; // Number of compared monomials.
 
-bool monomial::match(const monomial &other, size_t &where) const {
+template <class bitvector>
+bool monomial<bitvector>::match(const monomial &other, size_t &where) const {
 
   compared++;
 
@@ -339,303 +1341,3150 @@ bool monomial::match(const monomial &other, size_t &where) const {
   assert(mask == other.mask);
 #endif
 
-#ifdef FIXED
+  return values.match(other.values, where);
+}
 
-  // The fixed bit-vector version can use bit-twiddling hacks.
+// Cube operations used by iterated consensus ('--consensus').  A cube
+// contains another one if all its literals are literals of the other.
 
-  const word difference = values.bits ^ other.values.bits;
-  if (difference & (difference - 1)) // Not power-of two?
-    return false;
+template <class bitvector>
+bool monomial<bitvector>::contains(const monomial &other) const {
+  for (size_t i = 0; i != mask.width(); i++) {
+    const uint64_t m = mask.get_word(i);
+    if (m & ~other.mask.get_word(i))
+      return false;
+    if (m & (values.get_word(i) ^ other.values.get_word(i)))
+      return false;
+  }
+  return true;
+}
 
-  assert(difference); // Normalization makes them all different.
+// Two cubes intersect if no variable occurs with opposite signs.
+
+template <class bitvector>
+bool monomial<bitvector>::intersects(const monomial &other) const {
+  for (size_t i = 0; i != mask.width(); i++)
+    if (mask.get_word(i) & other.mask.get_word(i) &
+        (values.get_word(i) ^ other.values.get_word(i)))
+      return false;
+  return true;
+}
 
-  where = 1;
-  while ((word)1 << where != difference)
-    where++;
+// If exactly one variable occurs with opposite signs the consensus 'res'
+// consists of all other literals of both cubes and 'true' is returned.
 
+template <class bitvector>
+bool monomial<bitvector>::consensus(const monomial &other,
+                                    monomial &res) const {
+  uint64_t conflict = 0;
+  size_t where = 0;
+  for (size_t i = 0; i != mask.width(); i++) {
+    const uint64_t conflicts = mask.get_word(i) & other.mask.get_word(i) &
+                               (values.get_word(i) ^ other.values.get_word(i));
+    if (!conflicts)
+      continue;
+    if (conflict || (conflicts & (conflicts - 1)))
+      return false;
+    conflict = conflicts, where = i;
+  }
+  if (!conflict)
+    return false;
+  res = *this;
+  for (size_t i = 0; i != mask.width(); i++) {
+    uint64_t m = mask.get_word(i) | other.mask.get_word(i);
+    uint64_t v = values.get_word(i) | other.values.get_word(i);
+    if (i == where)
+      m &= ~conflict, v &= ~conflict;
+    res.mask.set_word(i, m), res.values.set_word(i, v);
+  }
+  res.ones = res.values.count();
   return true;
+}
 
-#else
+//------------------------------------------------------------------------//
 
-  // The generic bit-vector version has to use indexed access.
+// Polynomials store their monomials by default as an array of structures,
+// i.e., as a vector of monomials.  If compiled with '-DSOA' (configured with
+// './configure --soa') polynomials over word based bit-vectors instead use
+// a structure of arrays with separate vectors for the number of ones (as
+// small integer), the masks and the values.  This avoids padding and the
+// full 'size_t' for 'ones', and thus reduces the memory footprint for large
+// rounds.  It also lets the matching loops stream contiguous values.
 
-  bool matched = false;
+// Both storage types provide the same interface to polynomials.  Indexing
+// yields a monomial (a reference for structures and a copy for arrays).
 
-  for (auto i : variables) {
-    const bool this_value = values.get(i);
-    const bool other_value = other.values.get(i);
-    if (this_value == other_value)
-      continue;
-    if (this_value > other_value)
-      return false;
-    if (matched)
-      return false;
-    matched = true;
-    where = i;
+template <class bitvector> struct structures {
+
+  typedef ::monomial<bitvector> monomial;
+
+  vector<monomial> monomials;
+
+  size_t size() const { return monomials.size(); }
+  void clear() { monomials.clear(); }
+  void resize(size_t size) { monomials.resize(size); }
+  void swap(structures &other) { monomials.swap(other.monomials); }
+  void add(const monomial &m) { monomials.push_back(m); }
+  void set(size_t i, const monomial &m) { monomials[i] = m; }
+  const monomial &operator[](size_t i) const { return monomials[i]; }
+
+  void stable_sort() { std::stable_sort(monomials.begin(), monomials.end()); }
+
+  // Sort '[begin, end)' within a slice, i.e., with same 'ones' and 'mask'.
+
+  void sort_values(size_t begin, size_t end) {
+    std::sort(monomials.begin() + begin, monomials.begin() + end,
+              [](const monomial &a, const monomial &b) {
+                return a.values < b.values;
+              });
   }
+};
 
-  assert(matched); // Normalization makes thema ll different.
-  return matched;
+template <class bitvector> struct arrays {
 
-#endif
-}
+  typedef ::monomial<bitvector> monomial;
+  typedef typename conditional<(bitvector::max_variables < 256), uint8_t,
+                               uint16_t>::type count;
 
-//------------------------------------------------------------------------//
+  vector<count> ones;
+  vector<bitvector> masks;
+  vector<bitvector> values;
+  vector<bool> cares;
+  vector<uint32_t> tags; // Only used for multi-output functions.
+
+  size_t size() const { return ones.size(); }
+  void clear() {
+    ones.clear(), masks.clear(), values.clear(), cares.clear();
+    tags.clear();
+  }
+  void resize(size_t size) {
+    ones.resize(size), masks.resize(size), values.resize(size);
+    cares.resize(size, true);
+    if (outputs)
+      tags.resize(size);
+  }
+  void swap(arrays &other) {
+    ones.swap(other.ones), masks.swap(other.masks);
+    values.swap(other.values), cares.swap(other.cares);
+    tags.swap(other.tags);
+  }
+  void add(const monomial &m) {
+    ones.push_back(m.ones);
+    masks.push_back(m.mask);
+    values.push_back(m.values);
+    cares.push_back(m.care);
+    if (outputs)
+      tags.push_back(m.tags);
+  }
+  void set(size_t i, const monomial &m) {
+    ones[i] = m.ones, masks[i] = m.mask, values[i] = m.values;
+    cares[i] = m.care;
+    if (outputs)
+      tags[i] = m.tags;
+  }
+  monomial operator[](size_t i) const {
+    monomial m;
+    m.ones = ones[i];
+    m.care = cares[i];
+    m.tags = outputs ? tags[i] : 1;
+    m.mask = masks[i];
+    m.values = values[i];
+    return m;
+  }
+
+  // Sort a permutation and then apply it.
+
+  void stable_sort() {
+    vector<size_t> order(size());
+    for (size_t i = 0; i != order.size(); i++)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      if (ones[a] != ones[b])
+        return ones[a] < ones[b];
+      if (masks[a] != masks[b])
+        return masks[a] < masks[b];
+      return values[a] < values[b];
+    });
+    arrays sorted;
+    sorted.resize(size());
+    for (size_t i = 0; i != order.size(); i++)
+      sorted.set(i, (*this)[order[i]]);
+    swap(sorted);
+  }
+
+  // Within a slice only values differ and thus only they have to be sorted
+  // (together with the 'care' flags if the slice has don't-care monomials
+  // and the 'tags' of multi-output functions).
+
+  void sort_values(size_t begin, size_t end) {
+    if (!outputs && find(cares.begin() + begin, cares.begin() + end,
+                         false) == cares.begin() + end) {
+      std::sort(values.begin() + begin, values.begin() + end);
+      return;
+    }
+    vector<monomial> sorted;
+    for (size_t i = begin; i != end; i++)
+      sorted.push_back((*this)[i]);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const monomial &a, const monomial &b) {
+                return a.values < b.values;
+              });
+    for (size_t i = begin; i != end; i++)
+      set(i, sorted[i - begin]);
+  }
+};
+
+#ifdef SOA
+template <class bitvector>
+using storage = typename conditional<bitvector::bytes != 0, arrays<bitvector>,
+                                     structures<bitvector>>::type;
+#else
+template <class bitvector> using storage = structures<bitvector>;
+#endif
 
 // A polynomial is in essence a vector of monomials.
 
-struct polynomial {
+template <class bitvector> struct polynomial {
 
-  vector<monomial> monomials;
+  typedef ::monomial<bitvector> monomial;
 
-  void parse();
+  storage<bitvector> monomials;
+
+  void parse(const monomial &first);
+  void group();
+  void radix();
+  void arrange();
   void normalize();
   void debug() const;
-  void print(FILE *) const;
+  void print(FILE *, bool binary = binary_output) const;
 
-  bool empty() const { return monomials.empty(); }
+  bool empty() const { return !monomials.size(); }
   size_t size() const { return monomials.size(); }
   void clear() { monomials.clear(); }
-  void add(const monomial &m) { monomials.push_back(m); }
-  const monomial &operator[](size_t i) const { return monomials[i]; }
+  void swap(polynomial &other) { monomials.swap(other.monomials); }
+  void add(const monomial &m) { monomials.add(m); }
+  void append(const polynomial &);
+  decltype(auto) operator[](size_t i) const { return monomials[i]; }
 };
 
-void polynomial::parse() {
-  monomial m;
-  if (m.parse_first()) {
-    add(m);
-    while (m.parse_remaining())
-      add(m);
-  }
+template <class bitvector>
+void polynomial<bitvector>::append(const polynomial &other) {
+  const size_t size = other.size();
+  for (size_t i = 0; i != size; i++)
+    add(other[i]);
 }
 
-// Normalize the polynomial by sorting and removing duplicates.
+// Input cubes (lines with '-') are expanded into their minterms, since the
+// merge rule in 'generate' requires all implicants with one don't-care less
+// in the current round.  Minterms are enumerated in Gray code order, which
+// flips one don't-care position in each step.  Iterated consensus
+// ('--consensus') works on cubes directly and thus keeps them as they are.
+
+static thread_local bool iterated; // Set by '--consensus'.
+
+static bool expandable(size_t dont_cares, size_t bytes); // See below.
 
-void polynomial::normalize() {
-  stable_sort(monomials.begin(), monomials.end());
-  const auto begin = monomials.begin();
-  const auto end = monomials.end();
-  if (begin == end)
+template <class bitvector, class function>
+static void expand(monomial<bitvector> m, const function &add) {
+  if (iterated || m.mask.count() == variables) {
+    add(m);
     return;
-  auto j = begin + 1;
-  for (auto i = j; i != end; i++)
-    if (*i != j[-1])
-      *j++ = *i;
-  monomials.resize(j - begin);
+  }
+  vector<size_t> positions;
+  for (auto i : variables)
+    if (!m.mask.get(i))
+      positions.push_back(i), m.mask.set(i, true);
+  size_t bytes = sizeof m;
+  if (!bitvector::bytes)
+    bytes += 2 * binary_bytes(); // Words of 'generic' bit-vectors.
+  if (!expandable(positions.size(), bytes)) {
+    if (!binary_input && !given)
+      lineno--; // Already read the new-line.
+    parse_error("cube with %zu don't-cares too large to expand "
+                "(try '--consensus' or '--memory-limit')",
+                positions.size());
+  }
+  add(m);
+  const size_t minterms = (size_t)1 << positions.size();
+  for (size_t step = 1; step != minterms; step++) {
+    const size_t k = positions[__builtin_ctzll(step)];
+    const bool value = !m.values.get(k);
+    m.values.set(k, value);
+    if (value)
+      m.ones++;
+    else
+      m.ones--;
+    add(m);
+  }
 }
 
-void polynomial::debug() const {
-  for (auto m : monomials)
-    m.debug(), fputc('\n', stderr);
-}
+// Parse the remaining monomials after the already parsed 'first' one.
 
-void polynomial::print(FILE *file) const {
-  for (auto m : monomials)
-    m.print(file);
+template <class bitvector>
+void polynomial<bitvector>::parse(const monomial &first) {
+  profiled scope(PARSING);
+  monomial m = first;
+  const auto add = [this](const monomial &m) {
+    if (m.tags) // Otherwise not part of the on-set of any output.
+      this->add(m);
+  };
+  do
+    expand(m, add);
+  while (m.parse_remaining());
 }
 
-//------------------------------------------------------------------------//
+// Sorting with 'stable_sort' compares full monomials, which is costly in
+// particular for 'generic' bit-vectors.  Alternatively ('-n hash') we first
+// group monomials into slices with the same 'ones' and 'mask' by hashing,
+// then only sort the slices, which are usually much fewer than monomials,
+// and finally the values within each slice.  The result is the same.
 
-// This the kernel of the Quine-McCluskey algorithm.  It tries to determine
-// whether two monomials can be merged, i.e., only different in exactly one
-// variable.  If this is the case the monomials are merged, the result goes
-// to 'next' and the function returns 'true'. On failure return 'false'.
+enum normalization {
+  SORT_NORMALIZATION,
+  HASH_NORMALIZATION,
+  RADIX_NORMALIZATION
+};
 
-static inline bool consensus(const monomial &mi, const monomial &mj,
-                             polynomial &next) {
-  size_t k;
-  if (!mi.match(mj, k))
-    return false;
-  monomial m = mi;          // Copy values and mask of 'mi'.
-  assert(!m.values.get(k)); // As we have 'mi < mj' due to sorting.
-  m.mask.set(k, false);     // Clear mask-bit at position 'k'.
-  next.add(m);
-  return true;
-}
+static thread_local normalization normalization = SORT_NORMALIZATION;
 
-// Generate a normalized 'primes' polynomial of 'p' (destroys 'p') based on
-// the Quine-McCluskey algorithm in an non-optimzed and optimized variant.
+template <class bitvector> void polynomial<bitvector>::group() {
 
-void generate(polynomial &p, polynomial &primes) {
+  struct slice {
+    size_t ones;
+    bitvector mask;
+    size_t size, offset;
+  };
 
-  // The following two vectors are declared outside the main loop in order
-  // to avoid allocating and deallocating them.  Instead they are cleared.
+  vector<slice> slices;
+  vector<size_t> table(16); // Open addressing of 'slices' index plus one.
+  vector<size_t> where;     // Slice index of each monomial.
+  where.reserve(monomials.size());
 
-  vector<bool> prime; // Which monomials have been merged?
-  polynomial next;    // Monomials kept for next round.
+  const auto hash = [](size_t ones, const bitvector &mask) {
+    size_t res = (mask.hash() + ones) * 0x9e3779b97f4a7c15ull;
+    return res ^ (res >> 32); // Table index is taken from lower bits.
+  };
 
-  size_t round = 0;
+  const size_t size = monomials.size();
+  for (size_t j = 0; j != size; j++) {
+    const monomial &m = monomials[j];
+    if (2 * slices.size() >= table.size()) {
+      vector<size_t> larger(2 * table.size());
+      const size_t bits = larger.size() - 1;
+      for (size_t i = 0; i != slices.size(); i++) {
+        size_t h = hash(slices[i].ones, slices[i].mask) & bits;
+        while (larger[h])
+          h = (h + 1) & bits;
+        larger[h] = i + 1;
+      }
+      table.swap(larger);
+    }
+    const size_t bits = table.size() - 1;
+    size_t h = hash(m.ones, m.mask) & bits, i;
+    while ((i = table[h])) {
+      const slice &s = slices[i - 1];
+      if (s.ones == m.ones && s.mask == m.mask)
+        break;
+      h = (h + 1) & bits;
+    }
+    if (!i) {
+      slices.push_back({m.ones, m.mask, 0, 0});
+      table[h] = i = slices.size();
+    }
+    slices[i - 1].size++;
+    where.push_back(i - 1);
+  }
 
-  while (!p.empty()) { // As long monomials were merged.
+  vector<size_t> order;
+  for (size_t i = 0; i != slices.size(); i++)
+    order.push_back(i);
+  sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    const slice &s = slices[a], &t = slices[b];
+    return s.ones < t.ones || (s.ones == t.ones && s.mask < t.mask);
+  });
 
-    round++;
-    verbose("round %zu polynomial with %zu monomials", round, p.size());
+  size_t offset = 0;
+  for (auto i : order)
+    slices[i].offset = offset, offset += slices[i].size;
 
-    prime.clear();
-    const size_t size = p.size();
-    for (size_t i = 0; i != size; i++)
-      prime.push_back(true);
+  storage<bitvector> grouped;
+  grouped.resize(size);
+  for (size_t i = 0; i != size; i++)
+    grouped.set(slices[where[i]].offset++, monomials[i]);
+  monomials.swap(grouped);
 
-    next.clear();
+  for (const auto &s : slices)
+    monomials.sort_values(s.offset - s.size, s.offset);
+}
 
-#ifdef NOPTIMIZE
+// For word based bit-vectors we can use an LSD radix sort ('-n radix'),
+// which goes over the bytes of 'values', then 'mask' and finally 'ones' and
+// each time stably sorts by that byte with counting sort.  Bytes of 'mask'
+// and 'values' are complemented since bit-vectors are compared in reverse
+// (larger words come first).  Passes for which all monomials have the same
+// byte are skipped, which for instance avoids sorting unused high bytes.
 
-    // This is the simple unoptimized version, which compares all pairs
-    // (if enabled with './configure -n' or './configure --no-optimize').
+template <class bitvector> void polynomial<bitvector>::radix() {
 
-    for (size_t i = 0; i + 1 != size; i++)
-      for (size_t j = i + 1; j != size; j++)
-        if (consensus(p[i], p[j], next))
-          prime[i] = prime[j] = false;
+  const size_t size = monomials.size();
+  if (size < 2)
+    return;
 
-#else
+  size_t ones_bytes = 1;
+  while (ones_bytes != sizeof(size_t) && variables >> (8 * ones_bytes))
+    ones_bytes++;
 
-    // This is the optimized version (enabled by default).  It uses sorting
-    // by normalization to avoid a quadratic number of 'match' comparisons,
-    // similarly to one pass in merge-sort. But otherwise it relies on the
-    // same 'consensus' kernel.
+  const size_t bytes = bitvector::bytes;
+  const size_t digits = 2 * bytes + ones_bytes;
 
-    // A 'block' is an interval of monomials with the same number 'ones' of
-    // valid true bits'.  A 'slice' is an interval of monomials with the
-    // same number 'ones' of true bits (thus a sub-interval of a block) and
-    // also exactly the same valid bits in 'mask' set to true.
+  const auto digit = [bytes](const monomial &m, size_t i) -> unsigned {
+    if (i < bytes)
+      return 255 - m.values.byte(i);
+    if (i < 2 * bytes)
+      return 255 - m.mask.byte(i - bytes);
+    return (m.ones >> (8 * (i - 2 * bytes))) & 255;
+  };
 
-    // Only slices with the same 'mask' have to be compared in consecutive
-    // blocks.  Therefore we go over all pairs of subsequent blocks and
-    // compare corresponding slices within them.
+  // Counting all digits in one pass requires only one more pass over the
+  // monomials for each digit which actually needs to be sorted.
 
-    // As blocks are ordered by 'ones' and within blocks slices are ordered
-    // by 'mask' and we only need to compare monomials with the same number
-    // of ones and the same mask, the overall complexity of one outer main
-    // loop round becomes linear in the size of the outer polynomial 'p'.
+  vector<array<size_t, 256>> count(digits);
+  for (auto &c : count)
+    c.fill(0);
+  for (size_t j = 0; j != size; j++) {
+    const monomial &m = monomials[j];
+    for (size_t i = 0; i != digits; i++)
+      count[i][digit(m, i)]++;
+  }
 
-    size_t begin_first_block = 0;
-    size_t end_first_block = begin_first_block + 1;
-    while (end_first_block != size &&
-           p[begin_first_block].ones == p[end_first_block].ones)
-      end_first_block++;
+  storage<bitvector> sorted;
+  sorted.resize(size);
 
-    while (end_first_block != size) {
+  for (size_t i = 0; i != digits; i++) {
+    auto &c = count[i];
+    if (c[digit(monomials[0], i)] == size)
+      continue;
+    size_t offset = 0;
+    for (auto &o : c) {
+      const size_t tmp = o;
+      o = offset;
+      offset += tmp;
+    }
+    for (size_t j = 0; j != size; j++) {
+      const monomial &m = monomials[j];
+      sorted.set(c[digit(m, i)]++, m);
+    }
+    monomials.swap(sorted);
+  }
+}
 
-      const size_t begin_second_block = end_first_block;
-      size_t end_second_block = begin_second_block + 1;
+// Sort with the selected normalization mode.
 
-      while (end_second_block != size &&
-             p[begin_second_block].ones == p[end_second_block].ones)
-        end_second_block++;
+template <class bitvector> void polynomial<bitvector>::arrange() {
+  if constexpr (bitvector::bytes != 0)
+    if (normalization == RADIX_NORMALIZATION)
+      return radix();
+  if (normalization == SORT_NORMALIZATION)
+    monomials.stable_sort();
+  else
+    group();
+}
 
-      if (p[begin_first_block].ones + 1 == p[begin_second_block].ones) {
+// Normalize the polynomial by sorting and removing duplicates.
 
-        size_t begin_first_slice = begin_first_block;
-        size_t begin_second_slice = begin_second_block;
+template <class bitvector> void polynomial<bitvector>::normalize() {
+  profiled scope(NORMALIZING);
+  arrange();
+  const size_t size = monomials.size();
+  if (!size)
+    return;
+  size_t j = 1;
+  for (size_t i = 1; i != size; i++) {
+    const monomial &m = monomials[i];
+    if (m != monomials[j - 1])
+      monomials.set(j++, m);
+    else if (m.care != monomials[j - 1].care ||
+             m.tags != monomials[j - 1].tags) {
+      monomial kept = monomials[j - 1];
+      kept.care = kept.care || m.care; // Keep the on-set one.
+      kept.tags = kept.tags | m.tags;  // Input lines for different outputs.
+      monomials.set(j - 1, kept);
+    }
+  }
+  monomials.resize(j);
+}
 
-        while (begin_first_slice != end_first_block) {
+template <class bitvector> void polynomial<bitvector>::debug() const {
+  for (size_t i = 0; i != size(); i++)
+    monomials[i].debug(), fputc('\n', stderr);
+}
+
+// Monomials are printed or encoded directly into a large buffer, which is
+// written in chunks, instead of writing each character separately.
 
-          size_t end_first_slice = begin_first_slice + 1;
-          while (end_first_slice != end_first_block &&
-                 p[begin_first_slice].mask == p[end_first_slice].mask)
-            end_first_slice++;
+template <class bitvector>
+void polynomial<bitvector>::print(FILE *file, bool binary) const {
+  profiled scope(PRINTING);
+  const size_t bytes = binary ? 2 * binary_bytes() : line_length() + 1;
+  const size_t chunk = max((size_t)1 << 20, bytes);
+  vector<char> buffer(chunk);
+  char *start = buffer.data();
+  size_t filled = 0;
+  for (size_t i = 0; i != size(); i++) {
+    if (filled + bytes > chunk)
+      fwrite(start, 1, filled, file), filled = 0;
+    if (binary)
+      monomials[i].encode((unsigned char *)start + filled);
+    else
+      monomials[i].print(start + filled);
+    filled += bytes;
+  }
+  fwrite(start, 1, filled, file);
+}
 
-          while (begin_second_slice != end_second_block &&
-                 p[begin_first_slice].mask != p[begin_second_slice].mask)
-            begin_second_slice++;
+// The library engine passes each prime as string to a function instead.
 
-          if (begin_second_slice != end_second_block) {
+static thread_local const function<void(const char *)> *reporting;
 
-            size_t end_second_slice = begin_second_slice + 1;
-            while (end_second_slice != end_second_block &&
-                   p[begin_first_slice].mask == p[end_second_slice].mask)
-              end_second_slice++;
+template <class bitvector>
+static void report(const polynomial<bitvector> &primes) {
+  if (!reporting) {
+    primes.print(output_file);
+    fflush(output_file);
+    return;
+  }
+  vector<char> line(line_length() + 1);
+  for (size_t i = 0; i != primes.size(); i++) {
+    primes[i].print(line.data());
+    line[line_length()] = 0;
+    (*reporting)(line.data());
+  }
+}
 
-            // This is the same code as in the unoptimized version except
-            // that we can restrict the comparisons to smaller intervals.
+//------------------------------------------------------------------------//
 
-            for (size_t i = begin_first_slice; i != end_first_slice; i++)
-              for (size_t j = begin_second_slice; j != end_second_slice; j++)
-                if (consensus(p[i], p[j], next))
-                  prime[i] = prime[j] = false;
-          }
+// Merged monomials of a round are tracked in a bit-set with one bit per
+// monomial instead of one byte, which keeps it eight times smaller and thus
+// the cache lines written by different threads fewer.  Bits are set with
+// atomic word operations (with '-t <threads>' tasks might mark monomials
+// in the same word), but only if not set yet, since most monomials are
+// merged several times.  The batched SIMD matcher sets the bits of all
+// matched monomials of the second slice at once.  Monomials which are not
+// merged are found by scanning complemented words with 'ctz'.
 
-          begin_first_slice = end_first_slice;
-        }
+struct flags {
+  vector<uint64_t> words;
+  size_t size = 0;
+  void clear() { words.clear(), size = 0; }
+  void resize(size_t n) { size = n, words.resize((n + 63) / 64); }
+  bool operator[](size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+  static void set_bits(uint64_t &word, uint64_t bits) {
+    if ((__atomic_load_n(&word, __ATOMIC_RELAXED) & bits) != bits)
+      __atomic_fetch_or(&word, bits, __ATOMIC_RELAXED);
+  }
+  void set(size_t i) { set_bits(words[i / 64], (uint64_t)1 << (i % 64)); }
+
+  // Set the bits of 'bits' shifted by 'i' positions.
+
+  void set(size_t i, uint64_t bits) {
+    const size_t shift = i % 64;
+    set_bits(words[i / 64], bits << shift);
+    if (shift && bits >> (64 - shift))
+      set_bits(words[i / 64 + 1], bits >> (64 - shift));
+  }
+
+  // Call 'f' for all positions in '[0, size)' with the bit not set.
+
+  template <class function> void unset(const function &f) const {
+    for (size_t k = 0; k != words.size(); k++) {
+      uint64_t w = ~words[k];
+      if (k + 1 == words.size() && size % 64)
+        w &= ((uint64_t)1 << (size % 64)) - 1;
+      while (w) {
+        f(64 * k + __builtin_ctzll(w));
+        w &= w - 1;
       }
+    }
+  }
 
-      begin_first_block = begin_second_block;
-      end_first_block = end_second_block;
+  // Remove the first 'n' bits (used in external memory mode).
+
+  void drop(size_t n) {
+    const size_t q = n / 64, r = n % 64, remaining = words.size() - q;
+    for (size_t k = 0; k != remaining; k++) {
+      uint64_t w = words[k + q] >> r;
+      if (r && k + q + 1 != words.size())
+        w |= words[k + q + 1] << (64 - r);
+      words[k] = w;
     }
+    resize(size - n);
+  }
+};
 
-#endif
+//------------------------------------------------------------------------//
 
-    // All the monomials which were not merged are prime implicants.
+// This the kernel of the Quine-McCluskey algorithm.  It tries to determine
+// whether two monomials can be merged, i.e., only different in exactly one
+// variable.  If this is the case the monomials are merged, the result goes
+// to 'next' and both are marked as 'merged' (thus not prime).
 
-    for (size_t i = 0; i != size; i++)
-      if (prime[i])
-        primes.add(p[i]);
+// A merged monomial with 'd' don't-cares can be obtained from 'd' different
+// pairs, one for each of its don't-care positions.  Since all implicants
+// with one don't-care less are in the current polynomial (by induction over
+// the rounds starting with all minterms) it is enough to add the merged
+// monomial only for the pair where it is merged at its lowest don't-care,
+// i.e., if there is no don't-care below 'k' yet.  The other pairs still have
+// to report the merge though, since their monomials are not prime.  This
+// avoids adding duplicates to 'next' except for those in the input.  The
+// merged monomial covers an on-set minterm if one of the pair does ('care').
 
-    next.normalize(); // Sort and remove duplicates.
-    p = next;         // Now 'next' becomes new polynomial 'p'.
-  }
+// For multi-output functions the merged monomial is an implicant of the
+// outputs common to both ('tags').  Monomials are only marked as merged if
+// they keep all their outputs, since otherwise they are still prime for
+// sharing them among their outputs.  Each monomial has all outputs of which
+// it is an implicant (by induction again, after the input monomials got
+// the union of their tags during normalization), thus the merged monomial
+// gets the same tags for all pairs.  For single output functions all tags
+// are one and this reduces to plain merging.
+
+template <class bitvector>
+static inline void add(const monomial<bitvector> &mi, size_t k, bool care,
+                       size_t tags, polynomial<bitvector> &next) {
+  if (!mi.mask.all_set_below(k))
+    return;
+  monomial<bitvector> m = mi; // Copy values and mask of 'mi'.
+  assert(!m.values.get(k));   // As we have 'mi < mj' due to sorting.
+  m.mask.set(k, false);       // Clear mask-bit at position 'k'.
+  m.care = care;
+  m.tags = tags;
+  next.add(m);
+}
+
+template <class bitvector>
+static inline void merge(const monomial<bitvector> &mi,
+                         const monomial<bitvector> &mj, size_t k, flags &merged,
+                         size_t i, size_t j, polynomial<bitvector> &next) {
+  const size_t tags = mi.tags & mj.tags;
+  if (!tags)
+    return;
+  if (tags == mi.tags)
+    merged.set(i);
+  if (tags == mj.tags)
+    merged.set(j);
+  add(mi, k, mi.care || mj.care, tags, next);
+}
+
+template <class bitvector>
+static inline void consensus(const monomial<bitvector> &mi,
+                             const monomial<bitvector> &mj, flags &merged,
+                             size_t i, size_t j, polynomial<bitvector> &next) {
+  size_t k = 0;
+  if (mi.match(mj, k))
+    merge(mi, mj, k, merged, i, j, next);
 }
 
 //------------------------------------------------------------------------//
 
-// Parse command line options and set/reset input and output files.
+// For the fixed 32-bit and 64-bit kernels matching a monomial of the first
+// slice against the second slice boils down to checking whether the 'XOR'
+// of its values with each value of the second slice is a power of two.  The
+// following 'hits' functions check this for up to 64 consecutive values of
+// the second slice at once with SIMD instructions and return a bit-mask of
+// the matching positions.  The SIMD variant is selected at run-time based
+// on the capabilities of the CPU (or with '-s <simd>'), falling back to the
+// scalar version.  For 8-bit and 16-bit kernels slices are too small to
+// be worth it, and they always use plain pair-wise matching.
 
-static void init(int argc, char **argv) {
+template <typename word>
+static uint64_t scalar_hits(word value, const word *w, size_t n) {
+  uint64_t res = 0;
+  for (size_t j = 0; j != n; j++) {
+    const word difference = value ^ w[j];
+    res |= (uint64_t) !(difference & (difference - 1)) << j;
+  }
+  return res;
+}
 
-  for (int i = 1; i != argc; i++) {
-    const char *arg = argv[i];
-    if (!strcmp(arg, "-h")) {
-      fputs(usage, stderr);
-      exit(1);
-    } else if (!strcmp(arg, "-v"))
-      verbosity += verbosity >= 0 && (verbosity < INT_MAX);
-    else if (arg[0] == '-' && arg[1])
-      die("invalid option '%s' (try '-h')", arg);
-    else if (!input_path)
-      input_path = arg;
-    else if (!output_path)
-      output_path = arg;
-    else
-      die("too many files '%s', '%s', and '%s' (try '-h')", input_path,
-          output_path, arg);
+#if defined(__x86_64__)
+
+#include <immintrin.h>
+
+__attribute__((target("avx2"))) static uint64_t
+avx2_hits(uint64_t value, const uint64_t *w, size_t n) {
+  const __m256i v = _mm256_set1_epi64x(value);
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i zero = _mm256_setzero_si256();
+  uint64_t res = 0;
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4) {
+    const __m256i x = _mm256_loadu_si256((const __m256i *)(w + j));
+    const __m256i d = _mm256_xor_si256(x, v);
+    const __m256i e = _mm256_and_si256(d, _mm256_sub_epi64(d, one));
+    const __m256i z = _mm256_cmpeq_epi64(e, zero);
+    res |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(z)) << j;
   }
+  return res | scalar_hits(value, w + j, n - j) << j;
+}
 
-  if (!input_path || (input_path && !strcmp(input_path, "-")))
-    input_path = "<stdin>", input_file = stdin;
-  else if (!(input_file = fopen(input_path, "r")))
-    die("can not read '%s'", input_path);
-  else
-    close_input = true;
+__attribute__((target("avx2"))) static uint64_t
+avx2_hits(uint32_t value, const uint32_t *w, size_t n) {
+  const __m256i v = _mm256_set1_epi32(value);
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i zero = _mm256_setzero_si256();
+  uint64_t res = 0;
+  size_t j = 0;
+  for (; j + 8 <= n; j += 8) {
+    const __m256i x = _mm256_loadu_si256((const __m256i *)(w + j));
+    const __m256i d = _mm256_xor_si256(x, v);
+    const __m256i e = _mm256_and_si256(d, _mm256_sub_epi32(d, one));
+    const __m256i z = _mm256_cmpeq_epi32(e, zero);
+    res |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(z)) << j;
+  }
+  return res | scalar_hits(value, w + j, n - j) << j;
+}
 
-  if (!output_path || (output_path && !strcmp(output_path, "-")))
-    output_path = "<stdin>", output_file = stdout;
-  else if (!(output_file = fopen(output_path, "w")))
-    die("can not write '%s'", output_path);
-  else
-    close_output = true;
+__attribute__((target("avx512f"))) static uint64_t
+avx512_hits(uint64_t value, const uint64_t *w, size_t n) {
+  const __m512i v = _mm512_set1_epi64(value);
+  const __m512i one = _mm512_set1_epi64(1);
+  const __m512i zero = _mm512_setzero_si512();
+  uint64_t res = 0;
+  size_t j = 0;
+  for (; j + 8 <= n; j += 8) {
+    const __m512i x = _mm512_loadu_si512((const void *)(w + j));
+    const __m512i d = _mm512_xor_si512(x, v);
+    const __m512i e = _mm512_and_si512(d, _mm512_sub_epi64(d, one));
+    res |= (uint64_t)_mm512_cmpeq_epi64_mask(e, zero) << j;
+  }
+  return res | scalar_hits(value, w + j, n - j) << j;
 }
 
-static void reset(int argc) {
-  if (close_input)
-    fclose(input_file);
-  if (close_output)
-    fclose(output_file);
+__attribute__((target("avx512f"))) static uint64_t
+avx512_hits(uint32_t value, const uint32_t *w, size_t n) {
+  const __m512i v = _mm512_set1_epi32(value);
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i zero = _mm512_setzero_si512();
+  uint64_t res = 0;
+  size_t j = 0;
+  for (; j + 16 <= n; j += 16) {
+    const __m512i x = _mm512_loadu_si512((const void *)(w + j));
+    const __m512i d = _mm512_xor_si512(x, v);
+    const __m512i e = _mm512_and_si512(d, _mm512_sub_epi32(d, one));
+    res |= (uint64_t)_mm512_cmpeq_epi32_mask(e, zero) << j;
+  }
+  return res | scalar_hits(value, w + j, n - j) << j;
 }
 
-/*------------------------------------------------------------------------*/
+#elif defined(__aarch64__) && defined(__ARM_NEON)
 
-int main(int argc, char **argv) {
-  init(argc, argv);
-  polynomial minterms;
-  minterms.parse();
-  minterms.normalize();
-  polynomial primes, tmp = minterms;
-  generate(tmp, primes);
-  verbose("compared %zu monomials", compared);
-  primes.normalize();
-  verbose("primes polynomial with %zu monomials", primes.size());
-  primes.print(output_file);
-  reset(argc);
-  return 0;
+#include <arm_neon.h>
+
+static uint64_t neon_hits(uint64_t value, const uint64_t *w, size_t n) {
+  const uint64x2_t v = vdupq_n_u64(value);
+  const uint64x2_t one = vdupq_n_u64(1);
+  uint64_t res = 0;
+  size_t j = 0;
+  for (; j + 2 <= n; j += 2) {
+    const uint64x2_t d = veorq_u64(vld1q_u64(w + j), v);
+    const uint64x2_t z = vceqzq_u64(vandq_u64(d, vsubq_u64(d, one)));
+    res |= (vgetq_lane_u64(z, 0) & 1) << j;
+    res |= (vgetq_lane_u64(z, 1) & 1) << (j + 1);
+  }
+  return res | scalar_hits(value, w + j, n - j) << j;
+}
+
+static uint64_t neon_hits(uint32_t value, const uint32_t *w, size_t n) {
+  const uint32x4_t v = vdupq_n_u32(value);
+  const uint32x4_t one = vdupq_n_u32(1);
+  const uint32x4_t bits = {1, 2, 4, 8};
+  uint64_t res = 0;
+  size_t j = 0;
+  for (; j + 4 <= n; j += 4) {
+    const uint32x4_t d = veorq_u32(vld1q_u32(w + j), v);
+    const uint32x4_t z = vceqzq_u32(vandq_u32(d, vsubq_u32(d, one)));
+    res |= (uint64_t)vaddvq_u32(vandq_u32(z, bits)) << j;
+  }
+  return res | scalar_hits(value, w + j, n - j) << j;
 }
+
+#endif
+
+// The function implementing 'hits' for each word type (zero if disabled).
+
+template <typename word> struct batch {
+  static thread_local uint64_t (*hits)(word, const word *, size_t);
+};
+
+template <typename word>
+thread_local uint64_t (*batch<word>::hits)(word, const word *, size_t);
+
+static thread_local const char *simd; // Set by '-s <simd>'.
+
+static void select_simd() {
+  bool avx2 = false, avx512 = false, neon = false;
+#if defined(__x86_64__)
+  avx2 = __builtin_cpu_supports("avx2");
+  avx512 = __builtin_cpu_supports("avx512f");
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  neon = true;
+#endif
+  if (!simd)
+    simd = avx512 ? "avx512" : avx2 ? "avx2" : neon ? "neon" : "none";
+  if (!strcmp(simd, "none"))
+    return;
+  if (!strcmp(simd, "scalar")) {
+    batch<uint32_t>::hits = scalar_hits<uint32_t>;
+    batch<uint64_t>::hits = scalar_hits<uint64_t>;
+  }
+#if defined(__x86_64__)
+  else if (!strcmp(simd, "avx2")) {
+    if (!avx2)
+      die("CPU does not support 'avx2'");
+    batch<uint32_t>::hits = avx2_hits;
+    batch<uint64_t>::hits = avx2_hits;
+  } else if (!strcmp(simd, "avx512")) {
+    if (!avx512)
+      die("CPU does not support 'avx512'");
+    batch<uint32_t>::hits = avx512_hits;
+    batch<uint64_t>::hits = avx512_hits;
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  else if (!strcmp(simd, "neon")) {
+    batch<uint32_t>::hits = neon_hits;
+    batch<uint64_t>::hits = neon_hits;
+  }
+#endif
+  else
+    die("SIMD variant '%s' not available (try '-h')", simd);
+  verbose("using SIMD variant '%s'", simd);
+}
+
+//------------------------------------------------------------------------//
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+static size_t maximum_resident_set_size() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// With '--time-limit <seconds>' and '--memory-limit <megabytes>' the limits
+// are checked between rounds and before each task (or comparing the next
+// monomial with all others in the unoptimized version).  If one is exceeded
+// the current round is abandoned, the primes of the completed rounds are
+// written as usual, the state before the abandoned round optionally too
+// (with '--partial <file>' as checkpoint, see below), and 'quienny' exits
+// with the status below.  The limits are checked by all threads, which
+// pass their 'exceeded' status back like their counters (see 'worker').
+
+enum {
+  TIME_LIMIT_EXCEEDED = 2,
+  MEMORY_LIMIT_EXCEEDED = 3,
+};
+
+static thread_local double time_limit;        // '--time-limit <seconds>'.
+static thread_local size_t memory_limit;      // '--memory-limit <megabytes>'.
+static thread_local const char *partial_path; // Set by '--partial <file>'.
+static thread_local double started;           // Start time.
+static thread_local int exceeded; // Exit status if a limit was exceeded.
+
+// A cube with 'k' don't-cares expands to '2^k' minterms.  Without
+// '--memory-limit' cubes with more than 'expansion' don't-cares are
+// rejected, otherwise if their minterms alone do not fit into the limit.
+
+static const size_t expansion = 24; // Sixteen million minterms.
+
+static bool expandable(size_t dont_cares, size_t bytes) {
+  if (dont_cares >= 8 * sizeof(size_t) - 1)
+    return false;
+  if (!memory_limit)
+    return dont_cares <= expansion;
+  return ((size_t)1 << dont_cares) <= (memory_limit << 20) / bytes;
+}
+
+static bool exceeding() {
+  if (exceeded)
+    return true;
+  if (time_limit && now() - started > time_limit)
+    exceeded = TIME_LIMIT_EXCEEDED;
+  else if (memory_limit && maximum_resident_set_size() > memory_limit << 10)
+    exceeded = MEMORY_LIMIT_EXCEEDED;
+  return exceeded;
+}
+
+//------------------------------------------------------------------------//
+
+// The optimized version splits the work of one round into tasks, each
+// comparing the monomials of a first slice (or a part of it) against those of
+// the matching (same 'mask') second slice in the next block.  These tasks
+// are independent except that they might mark the same monomial as merged,
+// which is harmless as they all set the same bit.
+
+struct task {
+  size_t begin_first_slice, end_first_slice;
+  size_t begin_second_slice, end_second_slice;
+  size_t cost() const {
+    return (end_first_slice - begin_first_slice) *
+           (end_second_slice - begin_second_slice);
+  }
+};
+
+static thread_local unsigned threads = 1; // Set by '-t <threads>'.
+
+template <class bitvector>
+static void match_pairs(const polynomial<bitvector> &p, const task &t,
+                        flags &merged, polynomial<bitvector> &next) {
+
+  // This is the same code as in the unoptimized version except that we can
+  // restrict the comparisons to smaller intervals.
+
+  for (size_t i = t.begin_first_slice; i != t.end_first_slice; i++)
+    for (size_t j = t.begin_second_slice; j != t.end_second_slice; j++)
+      consensus(p[i], p[j], merged, i, j, next);
+}
+
+// Instead of comparing each monomial of the first slice with all monomials
+// in the second slice we can also flip each of its valid zero bits and look
+// up the result in the second slice with binary search, since the second
+// slice is sorted by values.  This needs 'zeros * log(second)' comparisons
+// per monomial instead of 'second' comparisons, where 'zeros' is the number
+// of valid zero bits, and thus is faster for large second slices.
+
+static thread_local size_t looked_up; // Number of flipped monomials.
+
+template <class bitvector>
+static void match_lookup(const polynomial<bitvector> &p, const task &t,
+                         flags &merged, polynomial<bitvector> &next) {
+
+  const size_t begin = t.begin_second_slice, end = t.end_second_slice;
+
+  for (size_t i = t.begin_first_slice; i != t.end_first_slice; i++) {
+    const auto &mi = p[i];
+    bitvector flipped = mi.values;
+    for (auto k : variables) {
+      if (!mi.mask.get(k) || mi.values.get(k))
+        continue;
+      looked_up++;
+      flipped.set(k, true);
+      size_t l = begin, r = end;
+      while (l < r) {
+        const size_t m = l + (r - l) / 2;
+        if (p[m].values < flipped)
+          l = m + 1;
+        else
+          r = m;
+      }
+      if (l != end && p[l].values == flipped)
+        merge(mi, p[l], k, merged, i, l, next);
+      flipped.set(k, false);
+    }
+  }
+}
+
+// Selected with '-m <matching>' but by default ('auto') we pick for each task
+// the strategy with the (estimated) smaller number of comparisons, where
+// batched SIMD comparisons are considered cheaper.
+
+enum matching { AUTO_MATCHING, PAIRS_MATCHING, LOOKUP_MATCHING };
+
+static thread_local matching matching = AUTO_MATCHING;
+
+template <class bitvector>
+static bool lookup(const polynomial<bitvector> &p, const task &t,
+                   bool batched) {
+  if (matching != AUTO_MATCHING)
+    return matching == LOOKUP_MATCHING;
+  const auto &m = p[t.begin_first_slice];
+  const size_t zeros = m.mask.count() - m.ones;
+  const size_t second = t.end_second_slice - t.begin_second_slice;
+  size_t log = 1;
+  while ((size_t)1 << log < second)
+    log++;
+  return (batched ? 32 : 1) * zeros * log < second;
+}
+
+template <class bitvector>
+static void execute(const polynomial<bitvector> &p, const task &t,
+                    flags &merged, polynomial<bitvector> &next) {
+  if (lookup(p, t, false))
+    match_lookup(p, t, merged, next);
+  else
+    match_pairs(p, t, merged, next);
+}
+
+// Fixed word kernels use the batch 'hits' function if available, which
+// needs the values of the second slice to be consecutive in memory.  With
+// structure of arrays storage they already are, otherwise they are copied.
+// The same applies to lookups, where zero bits are found with word
+// operations and the search can work on plain words.
+
+template <typename word>
+static void execute(const polynomial<fixed<word>> &p, const task &t,
+                    flags &merged, polynomial<fixed<word>> &next) {
+
+  typedef fixed<word> bitvector;
+  const auto hits = batch<word>::hits;
+  const size_t second = t.end_second_slice - t.begin_second_slice;
+  const bool flip = lookup(p, t, hits);
+
+  if (!flip && (!hits || second < 4)) {
+    match_pairs(p, t, merged, next);
+    return;
+  }
+
+  static_assert(sizeof(bitvector) == sizeof(word), "unexpected padding");
+
+  const word *values;
+  if constexpr (is_same<storage<bitvector>, arrays<bitvector>>::value)
+    values = (const word *)p.monomials.values.data() + t.begin_second_slice;
+  else {
+    static thread_local vector<word> copied;
+    copied.resize(second);
+    for (size_t j = 0; j != second; j++)
+      copied[j] = p[t.begin_second_slice + j].values.bits;
+    values = copied.data();
+  }
+
+  for (size_t i = t.begin_first_slice; i != t.end_first_slice; i++) {
+    const auto &mi = p[i];
+    const word value = mi.values.bits;
+    if (flip) {
+      word zeros = mi.mask.bits & ~value;
+      while (zeros) {
+        const size_t k = __builtin_ctzll(zeros);
+        zeros &= zeros - 1;
+        const word flipped = value | (word)1 << k;
+        looked_up++;
+        // Values are sorted in reverse, i.e., larger words come first.
+        const word *w = lower_bound(values, values + second, flipped,
+                                    greater<word>());
+        if (w != values + second && *w == flipped) {
+          const size_t j = t.begin_second_slice + (w - values);
+          merge(mi, p[j], k, merged, i, j, next);
+        }
+      }
+    } else
+      for (size_t offset = 0; offset < second; offset += 64) {
+        const size_t n = min(second - offset, (size_t)64);
+        uint64_t found = hits(value, values + offset, n);
+        compared += n;
+        if (!found)
+          continue;
+        const size_t begin = t.begin_second_slice + offset;
+        if (outputs) {
+          while (found) {
+            const size_t j = __builtin_ctzll(found);
+            found &= found - 1;
+            merge(mi, p[begin + j], __builtin_ctzll(value ^ values[offset + j]),
+                  merged, i, begin + j, next);
+          }
+          continue;
+        }
+        merged.set(i), merged.set(begin, found); // All keep their output.
+        while (found) {
+          const size_t j = __builtin_ctzll(found);
+          found &= found - 1;
+          add(mi, __builtin_ctzll(value ^ values[offset + j]),
+              mi.care || p[begin + j].care, 1, next);
+        }
+      }
+  }
+}
+
+// Options and the parameters of a run are local to threads, thus several
+// runs (functions of '--batch' or calls of library engines) are solved
+// concurrently by different threads without sharing any state.  A
+// 'context' holds them, such that worker threads started by a run inherit
+// them, and library engines keep their own between calls (see 'save' and
+// 'restore' below, after all options).
+
+struct kernel;
+
+struct context {
+  const char *input_path = 0, *output_path = 0;
+  bool binary_input = false, binary_output = false;
+  int verbosity = 0;
+  const kernel *forced_kernel = 0;
+  enum normalization normalization = SORT_NORMALIZATION;
+  enum matching matching = AUTO_MATCHING;
+  const char *simd = 0;
+  uint64_t (*hits32)(uint32_t, const uint32_t *, size_t) = 0;
+  uint64_t (*hits64)(uint64_t, const uint64_t *, size_t) = 0;
+  unsigned threads = 1;
+  size_t external = 0;
+  const char *dont_care_path = 0;
+  bool streaming = false, pipelining = false, iterated = false;
+  bool covering = false, batching = false, stats = false;
+  double time_limit = 0;
+  size_t memory_limit = 0;
+  const char *checkpoint_path = 0, *resume_path = 0;
+  const char *partial_path = 0, *stats_path = 0;
+  double started = 0;
+  range variables;
+  size_t outputs = 0;
+  size_t bytes = 0;           // Of the pool.
+  vector<void *> *chunks = 0; // Of the pool.
+};
+
+static context save();
+static void restore(const context &);
+
+// Execute all tasks either directly or distributed over worker threads,
+// which take the next task from the shared 'tasks' vector.  Each worker
+// thread has its own 'next' polynomial appended to the global one at the
+// end.  The same applies to the thread local 'compared' and 'looked_up'
+// counters and the 'exceeded' status.
+
+template <class bitvector> struct worker {
+  polynomial<bitvector> next;
+  vector<polynomial<bitvector>> parts; // Per 'ones' with '--pipeline'.
+  size_t compared = 0;
+  size_t looked_up = 0;
+  int exceeded = 0;
+};
+
+// Split large tasks along their first slice to balance the load.
+
+static inline void split(vector<task> &tasks) {
+
+  size_t total = 0;
+  for (const auto &t : tasks)
+    total += t.cost();
+
+  const size_t grain = max(total / (16 * (size_t)threads), (size_t)1 << 12);
+  const size_t original = tasks.size();
+  for (size_t i = 0; i != original; i++) {
+    task t = tasks[i];
+    const size_t second = t.end_second_slice - t.begin_second_slice;
+    const size_t step = max(grain / second, (size_t)1);
+    while (t.begin_first_slice + step < t.end_first_slice) {
+      task part = t;
+      part.end_first_slice = part.begin_first_slice + step;
+      t.begin_first_slice = part.end_first_slice;
+      tasks.push_back(part);
+    }
+    tasks[i] = t;
+  }
+}
+
+template <class bitvector>
+static void execute(const polynomial<bitvector> &p, vector<task> &tasks,
+                    flags &merged, vector<worker<bitvector>> &workers,
+                    polynomial<bitvector> &next) {
+
+  if (threads < 2 || tasks.size() < 2) {
+    profiled scope(MATCHING);
+    for (size_t i = 0; !exceeding() && i != tasks.size(); i++)
+      execute(p, tasks[i], merged, next);
+    return;
+  }
+
+  // Split large tasks and then schedule the expensive tasks first.
+
+  split(tasks);
+
+  sort(tasks.begin(), tasks.end(), [](const task &a, const task &b) {
+    return a.cost() > b.cost();
+  });
+
+  atomic<size_t> scheduled(0);
+
+  auto loop = [&](polynomial<bitvector> &local) {
+    profiled scope(MATCHING);
+    size_t i;
+    while (!exceeding() && (i = scheduled++) < tasks.size())
+      execute(p, tasks[i], merged, local);
+  };
+
+  workers.resize(threads - 1);
+  vector<thread> running;
+  const context shared = save();
+  for (auto &w : workers) {
+    w.next.clear();
+    running.emplace_back([&]() {
+      restore(shared);
+      loop(w.next);
+      w.compared = compared;
+      w.looked_up = looked_up;
+      w.exceeded = exceeded;
+    });
+  }
+
+  loop(next);
+
+  for (auto &t : running)
+    t.join();
+
+  for (auto &w : workers) {
+    compared += w.compared;
+    looked_up += w.looked_up;
+    if (!exceeded)
+      exceeded = w.exceeded;
+    next.append(w.next);
+  }
+}
+
+// With '--pipeline' merged monomials are partitioned by 'ones' while
+// matching.  A merged monomial has the same 'ones' as the monomial of the
+// first block it was merged from, thus each partition is produced by the
+// tasks of one pair of blocks.  Tasks are executed in the order of blocks
+// and the thread completing the last task of a partition collects and
+// normalizes it, while the other threads continue matching the following
+// blocks.  Since 'next' is ordered by 'ones' first, the normalized
+// partitions are simply concatenated.  Sorting the small partitions is also
+// faster than sorting 'next' at once, even with a single thread.  Returns
+// the number of merged monomials before removing duplicates.
+
+static thread_local bool pipelining; // Set by '--pipeline'.
+
+template <class bitvector>
+static size_t pipeline(const polynomial<bitvector> &p, vector<task> &tasks,
+                       flags &merged, vector<worker<bitvector>> &workers,
+                       vector<polynomial<bitvector>> &parts,
+                       polynomial<bitvector> &next) {
+
+  const auto ones = [&](const task &t) -> size_t {
+    return p[t.begin_first_slice].ones;
+  };
+
+  split(tasks);
+
+  sort(tasks.begin(), tasks.end(), [&](const task &a, const task &b) {
+    const size_t i = ones(a), j = ones(b);
+    return i < j || (i == j && a.cost() > b.cost());
+  });
+
+  const size_t n = variables;
+  vector<atomic<size_t>> pending(n + 1); // Remaining tasks per partition.
+  for (auto &k : pending)
+    k = 0;
+  for (const auto &t : tasks)
+    pending[ones(t)]++;
+
+  parts.resize(n + 1);
+  for (auto &part : parts)
+    part.clear();
+
+  workers.resize(threads);
+  for (auto &w : workers) {
+    w.parts.resize(n + 1);
+    for (auto &part : w.parts)
+      part.clear();
+  }
+
+  atomic<size_t> scheduled(0), produced(0);
+
+  auto loop = [&](worker<bitvector> &w) {
+    profiled scope(MATCHING);
+    size_t i;
+    while (!exceeding() && (i = scheduled++) < tasks.size()) {
+      const size_t k = ones(tasks[i]);
+      execute(p, tasks[i], merged, w.parts[k]);
+      if (--pending[k])
+        continue;
+      auto &part = parts[k];
+      for (auto &other : workers)
+        part.append(other.parts[k]), other.parts[k].clear();
+      produced += part.size();
+      part.normalize();
+    }
+  };
+
+  vector<thread> running;
+  const context shared = save();
+  for (size_t i = 1; i != workers.size(); i++) {
+    auto &w = workers[i];
+    running.emplace_back([&]() {
+      restore(shared);
+      loop(w);
+      w.compared = compared;
+      w.looked_up = looked_up;
+      w.exceeded = exceeded;
+    });
+  }
+
+  loop(workers[0]);
+
+  for (auto &t : running)
+    t.join();
+
+  for (size_t i = 1; i != workers.size(); i++) {
+    compared += workers[i].compared;
+    looked_up += workers[i].looked_up;
+    if (!exceeded)
+      exceeded = workers[i].exceeded;
+  }
+
+  next.clear();
+  for (const auto &part : parts)
+    next.append(part);
+
+  return produced;
+}
+
+#ifndef NOPTIMIZE
+
+// Add tasks for all pairs of slices with the same 'mask' in the first block
+// '[begin_first_block, begin_second_block)' and the second block
+// '[begin_second_block, end_second_block)' with one more true bit.
+
+template <class bitvector>
+static void schedule(const polynomial<bitvector> &p, size_t begin_first_block,
+                     size_t begin_second_block, size_t end_second_block,
+                     vector<task> &tasks) {
+  const size_t end_first_block = begin_second_block;
+  size_t begin_first_slice = begin_first_block;
+  size_t begin_second_slice = begin_second_block;
+
+  while (begin_first_slice != end_first_block) {
+
+    size_t end_first_slice = begin_first_slice + 1;
+    while (end_first_slice != end_first_block &&
+           p[begin_first_slice].mask == p[end_first_slice].mask)
+      end_first_slice++;
+
+    // Slices are sorted by 'mask' in both blocks, so we can skip
+    // second slices with smaller masks, but have to stop at larger
+    // ones, since the first slice might not have a partner at all.
+
+    while (begin_second_slice != end_second_block &&
+           p[begin_second_slice].mask < p[begin_first_slice].mask)
+      begin_second_slice++;
+
+    if (begin_second_slice != end_second_block &&
+        p[begin_first_slice].mask == p[begin_second_slice].mask) {
+
+      size_t end_second_slice = begin_second_slice + 1;
+      while (end_second_slice != end_second_block &&
+             p[begin_first_slice].mask == p[end_second_slice].mask)
+        end_second_slice++;
+
+      tasks.push_back({begin_first_slice, end_first_slice,
+                       begin_second_slice, end_second_slice});
+    }
+
+    begin_first_slice = end_first_slice;
+  }
+}
+
+#endif
+
+// Per round statistics are collected with '--stats' (printed to 'stderr')
+// or '--stats-json <file>' (written as JSON to the given file) and only then
+// cost an additional pass over the polynomial to count blocks and slices.
+
+struct statistics {
+  size_t round = 0;         // Round number (starting with one).
+  size_t monomials = 0;     // Size of 'p'.
+  size_t blocks = 0;        // Number of blocks of 'p'.
+  size_t slices = 0;        // Number of slices of 'p'.
+  size_t largest = 0;       // Size of largest slice.
+  size_t compared = 0;      // Compared monomials (all threads).
+  size_t looked_up = 0;     // Looked up flipped monomials (all threads).
+  size_t merged = 0;        // Monomials added to 'next'.
+  size_t duplicates = 0;    // Removed from 'next' by normalization.
+  size_t primes = 0;        // Primes found in this round.
+  double matching = 0;      // Time spent matching slices.
+  double extracting = 0;    // Time spent extracting (and printing) primes.
+  double normalizing = 0;   // Time spent normalizing 'next'.
+  size_t memory = 0;        // Maximum resident set size in kilobytes.
+};
+
+static thread_local bool stats;             // Set by '--stats'.
+static thread_local const char *stats_path; // Set by '--stats-json <file>'.
+static thread_local vector<statistics> rounds; // Statistics of all rounds.
+static thread_local double parsing, normalizing; // Before the first round.
+static thread_local double finishing; // Time spent normalizing and printing.
+
+template <class bitvector>
+static void count_slices(const polynomial<bitvector> &p, statistics &s) {
+  const size_t size = p.size();
+  size_t begin = 0;
+  while (begin != size) {
+    size_t end = begin + 1;
+    while (end != size && p[begin].ones == p[end].ones &&
+           p[begin].mask == p[end].mask)
+      end++;
+    if (!begin || p[begin - 1].ones != p[begin].ones)
+      s.blocks++;
+    s.slices++;
+    s.largest = max(s.largest, end - begin);
+    begin = end;
+  }
+}
+
+static void print_statistics() {
+  if (stats) {
+    fprintf(stderr,
+            "%5s %10s %8s %8s %8s %12s %12s %10s %6s %10s %9s %9s %9s "
+            "%8s\n",
+            "round", "monomials", "blocks", "slices", "largest", "compared",
+            "looked-up", "merged", "dups", "primes", "matching", "extract",
+            "normalize", "memory");
+    for (const auto &r : rounds)
+      fprintf(stderr,
+              "%5zu %10zu %8zu %8zu %8zu %12zu %12zu %10zu %6zu %10zu %8.3fs "
+              "%8.3fs %8.3fs %6zuMB\n",
+              r.round, r.monomials, r.blocks, r.slices, r.largest, r.compared,
+              r.looked_up, r.merged, r.duplicates, r.primes, r.matching,
+              r.extracting, r.normalizing, r.memory >> 10);
+    fprintf(stderr,
+            "parsing %.3fs, normalizing %.3fs, finishing %.3fs, "
+            "memory %zuMB\n",
+            parsing, normalizing, finishing,
+            maximum_resident_set_size() >> 10);
+  }
+  if (stats_path) {
+    FILE *file = fopen(stats_path, "w");
+    if (!file)
+      die("can not write '%s'", stats_path);
+    fprintf(file, "{\n  \"variables\": %zu,\n", (size_t)variables);
+    fprintf(file, "  \"parsing\": %.6f,\n", parsing);
+    fprintf(file, "  \"normalizing\": %.6f,\n", normalizing);
+    fprintf(file, "  \"finishing\": %.6f,\n", finishing);
+    fprintf(file, "  \"memory\": %zu,\n", maximum_resident_set_size());
+    fputs("  \"rounds\": [", file);
+    for (size_t i = 0; i != rounds.size(); i++) {
+      const auto &r = rounds[i];
+      fprintf(file,
+              "%s\n    {\"round\": %zu, \"monomials\": %zu, \"blocks\": %zu, "
+              "\"slices\": %zu, \"largest\": %zu, \"compared\": %zu, "
+              "\"looked_up\": %zu, "
+              "\"merged\": %zu, \"duplicates\": %zu, \"primes\": %zu, "
+              "\"matching\": %.6f, \"extracting\": %.6f, "
+              "\"normalizing\": %.6f, \"memory\": %zu}",
+              i ? "," : "", r.round, r.monomials, r.blocks, r.slices,
+              r.largest, r.compared, r.looked_up, r.merged, r.duplicates,
+              r.primes, r.matching, r.extracting, r.normalizing, r.memory);
+    }
+    fputs("\n  ]\n}\n", file);
+    fclose(file);
+  }
+}
+
+// With '--checkpoint <file>' the state after each round, i.e., the number
+// of completed rounds, the normalized polynomial 'p' for the next round and
+// the primes found so far (not yet written if streaming), is saved to the
+// given file.  It is written to a temporary file first and then renamed,
+// so a preempted run always leaves a complete checkpoint behind.  The
+// header consists of the eight bytes 'quiennyc' followed by the number of
+// variables, completed rounds, monomials in 'p' and primes (all as 64-bit
+// little endian numbers).  Then the monomials of 'p' and the primes follow
+// in the binary format.  A run is continued with '--resume <file>'.
+
+static const char checkpoint_magic[8] = {'q', 'u', 'i', 'e',
+                                         'n', 'n', 'y', 'c'};
+
+static thread_local const char *checkpoint_path; // '--checkpoint <file>'.
+static thread_local const char *resume_path;     // '--resume <file>'.
+static size_t resumed;              // Rounds completed before resuming.
+static size_t resumed_monomials;    // Size of 'p' in checkpoint.
+static size_t resumed_primes;       // Number of primes in checkpoint.
+
+static void write_checkpoint_header(FILE *file, size_t round,
+                                    size_t monomials, size_t primes) {
+  unsigned char header[40];
+  memcpy(header, checkpoint_magic, sizeof checkpoint_magic);
+  encode_number(variables, header + 8);
+  encode_number(round, header + 16);
+  encode_number(monomials, header + 24);
+  encode_number(primes, header + 32);
+  fwrite(header, 1, sizeof header, file);
+}
+
+template <class bitvector>
+static void write_checkpoint(const polynomial<bitvector> &p,
+                             const polynomial<bitvector> &primes,
+                             size_t round) {
+  const size_t length = strlen(checkpoint_path);
+  vector<char> tmp(length + 5);
+  memcpy(tmp.data(), checkpoint_path, length);
+  memcpy(tmp.data() + length, ".tmp", 5);
+  FILE *file = fopen(tmp.data(), "w");
+  if (!file)
+    die("can not write '%s'", tmp.data());
+  write_checkpoint_header(file, round, p.size(), primes.size());
+  p.print(file, true);
+  primes.print(file, true);
+  const bool failed = ferror(file);
+  if (fclose(file) || failed)
+    die("writing '%s' failed", tmp.data());
+  if (rename(tmp.data(), checkpoint_path))
+    die("can not rename '%s' to '%s'", tmp.data(), checkpoint_path);
+  verbose("checkpoint after round %zu with %zu monomials and %zu primes",
+          round, p.size(), primes.size());
+}
+
+// With '--partial <file>' the state before an abandoned round, i.e., its
+// polynomial 'p' and the primes of the completed rounds, is written in the
+// same format, thus '--resume <file>' continues with the abandoned round.
+
+static FILE *open_partial(size_t round, size_t monomials, size_t primes) {
+  FILE *file = fopen(partial_path, "w");
+  if (!file)
+    die("can not write '%s'", partial_path);
+  write_checkpoint_header(file, round, monomials, primes);
+  return file;
+}
+
+static void close_partial(FILE *file, size_t round, size_t monomials,
+                          size_t primes) {
+  const bool failed = ferror(file);
+  if (fclose(file) || failed)
+    die("writing '%s' failed", partial_path);
+  verbose("wrote state after round %zu with %zu monomials and %zu primes "
+          "to '%s'",
+          round, monomials, primes, partial_path);
+}
+
+template <class bitvector>
+static void write_partial(const polynomial<bitvector> &p,
+                          const polynomial<bitvector> &primes,
+                          size_t round) {
+  if (!partial_path)
+    return;
+  FILE *file = open_partial(round, p.size(), primes.size());
+  p.print(file, true);
+  primes.print(file, true);
+  close_partial(file, round, p.size(), primes.size());
+}
+
+// The header is parsed first to determine the number of variables and thus
+// the kernel, then the monomials are parsed by the selected kernel.
+
+#ifndef LIBRARY
+static void parse_checkpoint_header() {
+  const unsigned char *header = read_bytes(40);
+  if (!header)
+    parse_error("unexpected end-of-file (expected checkpoint header)");
+  if (memcmp(header, checkpoint_magic, sizeof checkpoint_magic))
+    parse_error("invalid checkpoint header");
+  parse_variables(header + 8);
+  resumed = decode_number(header + 16);
+  resumed_monomials = decode_number(header + 24);
+  resumed_primes = decode_number(header + 32);
+}
+#endif
+
+template <class bitvector>
+static void parse_checkpoint(polynomial<bitvector> &p,
+                             polynomial<bitvector> &primes) {
+  monomial<bitvector> m;
+  for (size_t i = 0; i != resumed_monomials + resumed_primes; i++) {
+    if (!m.parse_binary())
+      parse_error("unexpected end-of-file (expected %zu monomials)",
+                  resumed_monomials + resumed_primes - i);
+    if (i < resumed_monomials)
+      p.add(m);
+    else
+      primes.add(m);
+  }
+  if (read_bytes(1))
+    parse_error("unexpected bytes after %zu monomials",
+                resumed_monomials + resumed_primes);
+  verbose("resuming after round %zu with %zu monomials and %zu primes",
+          resumed, p.size(), primes.size());
+}
+
+// With '--stream' the primes of each round are written and flushed right
+// after the round instead of collecting all of them in 'primes'.  As 'p' is
+// normalized, they are sorted within each round, and since primes of
+// different rounds have a different number of don't-cares, concatenating
+// these sorted runs yields the same set as without streaming.
+
+static thread_local bool streaming; // Set by '--stream'.
+static size_t streamed; // Number of primes written while streaming.
+
+// Generate a normalized 'primes' polynomial of 'p' (destroys 'p') based on
+// the Quine-McCluskey algorithm in an non-optimzed and optimized variant.
+
+template <class bitvector>
+void generate(polynomial<bitvector> &p, polynomial<bitvector> &primes) {
+
+  // The following vectors are declared outside the main loop in order to
+  // avoid allocating and deallocating them.  Instead they are cleared.  They
+  // are even static (per thread), so the library engine and '--batch' keep
+  // them between calls.
+
+  static thread_local flags merged; // Merged monomials.
+  static thread_local polynomial<bitvector> next; // Kept for next round.
+
+#ifndef NOPTIMIZE
+  static thread_local vector<task> tasks;                // Slice pairs.
+  static thread_local vector<worker<bitvector>> workers; // '-t <threads>'.
+  static thread_local vector<polynomial<bitvector>> parts; // '--pipeline'.
+#endif
+
+  size_t round = resumed;
+  size_t completed = resumed; // Rounds before the abandoned one.
+
+  while (!p.empty()) { // As long monomials were merged.
+
+    if (exceeding())
+      break;
+
+    round++;
+    verbose("round %zu polynomial with %zu monomials", round, p.size());
+
+    const bool statistics = stats || stats_path;
+    ::statistics s;
+    double start = 0;
+    if (statistics) {
+      s.round = round, s.monomials = p.size();
+      s.compared = compared, s.looked_up = looked_up;
+      count_slices(p, s);
+      start = now();
+    }
+
+    const size_t size = p.size();
+    merged.clear();
+    merged.resize(size);
+
+    next.clear();
+
+    bool normalized = false; // Already by '--pipeline'.
+    size_t produced = 0;     // Merged monomials before normalization.
+
+#ifdef NOPTIMIZE
+
+    // This is the simple unoptimized version, which compares all pairs
+    // (if enabled with './configure -n' or './configure --no-optimize').
+
+    {
+      profiled scope(MATCHING);
+      for (size_t i = 0; i + 1 != size && !exceeding(); i++)
+        for (size_t j = i + 1; j != size; j++)
+          consensus(p[i], p[j], merged, i, j, next);
+    }
+
+#else
+    // This is the optimized version (enabled by default).  It uses sorting
+    // by normalization to avoid a quadratic number of 'match' comparisons,
+    // similarly to one pass in merge-sort. But otherwise it relies on the
+    // same 'consensus' kernel.
+
+    // A 'block' is an interval of monomials with the same number 'ones' of
+    // valid true bits'.  A 'slice' is an interval of monomials with the
+    // same number 'ones' of true bits (thus a sub-interval of a block) and
+    // also exactly the same valid bits in 'mask' set to true.
+
+    // Only slices with the same 'mask' have to be compared in consecutive
+    // blocks.  Therefore we go over all pairs of subsequent blocks and
+    // compare corresponding slices within them.
+
+    // As blocks are ordered by 'ones' and within blocks slices are ordered
+    // by 'mask' and we only need to compare monomials with the same number
+    // of ones and the same mask, the overall complexity of one outer main
+    // loop round becomes linear in the size of the outer polynomial 'p'.
+
+    tasks.clear();
+
+    size_t begin_first_block = 0;
+    size_t end_first_block = begin_first_block + 1;
+    while (end_first_block != size &&
+           p[begin_first_block].ones == p[end_first_block].ones)
+      end_first_block++;
+
+    while (end_first_block != size) {
+
+      const size_t begin_second_block = end_first_block;
+      size_t end_second_block = begin_second_block + 1;
+
+      while (end_second_block != size &&
+             p[begin_second_block].ones == p[end_second_block].ones)
+        end_second_block++;
+
+      if (p[begin_first_block].ones + 1 == p[begin_second_block].ones) {
+
+        schedule(p, begin_first_block, begin_second_block, end_second_block,
+                 tasks);
+      }
+
+      begin_first_block = begin_second_block;
+      end_first_block = end_second_block;
+    }
+
+    if (pipelining)
+      produced = pipeline(p, tasks, merged, workers, parts, next),
+      normalized = true;
+    else
+      execute(p, tasks, merged, workers, next);
+
+#endif
+
+    if (exceeded)
+      break; // Keep 'p' of the abandoned round.
+
+    if (statistics) {
+      const double end = now();
+      s.matching = end - start, start = end;
+      s.compared = compared - s.compared;
+      s.looked_up = looked_up - s.looked_up;
+      s.merged = normalized ? produced : next.size();
+      s.primes = primes.size();
+    }
+
+    // All the monomials which were not merged are prime implicants, unless
+    // they cover only don't-cares.
+
+    {
+      profiled scope(EXTRACTING);
+      merged.unset([&](size_t i) {
+        if (p[i].care)
+          primes.add(p[i]);
+      });
+    }
+
+    if (statistics)
+      s.primes = primes.size() - s.primes;
+
+    if (streaming) {
+      primes.print(output_file);
+      fflush(output_file);
+      streamed += primes.size();
+      primes.clear();
+    }
+
+    if (statistics) {
+      const double end = now();
+      s.extracting = end - start, start = end;
+    }
+
+    if (!normalized)
+      next.normalize(); // Sort and remove duplicates.
+    p.swap(next);       // Now 'next' becomes new polynomial 'p'.
+    completed = round;
+
+    if (checkpoint_path)
+      write_checkpoint(p, primes, round);
+
+    if (statistics) {
+      s.normalizing = now() - start;
+      s.duplicates = s.merged - p.size();
+      s.memory = maximum_resident_set_size();
+      rounds.push_back(s);
+    }
+  }
+
+  if (exceeded)
+    write_partial(p, primes, completed);
+
+  // Keep the capacity but release pooled bit-vectors of 'generic' before
+  // the pool is reset.
+
+  next.clear();
+#ifndef NOPTIMIZE
+  for (auto &w : workers) {
+    w.next.clear();
+    for (auto &part : w.parts)
+      part.clear();
+  }
+  for (auto &part : parts)
+    part.clear();
+#endif
+}
+
+//------------------------------------------------------------------------//
+
+// In external memory mode ('-e <megabytes>') polynomials are not kept in
+// memory but as sorted sequences of binary monomials in temporary files.
+// Each round reads 'p' block by block, keeping only two subsequent blocks
+// in memory, and merged monomials in 'next' are sorted and spilled as soon
+// as they exceed the memory limit.  These sorted runs are then merged into
+// the next polynomial.  Since the primes of a round are found in sorted
+// order, each round contributes one sorted sequence of primes, and merging
+// them at the end gives the same output as without external memory mode.
+
+static thread_local size_t external; // Set by '-e <megabytes>'.
+
+struct sequence {
+  FILE *file = 0;  // Temporary file (deleted on closing).
+  size_t size = 0; // Number of monomials in it.
+};
+
+static FILE *temporary() {
+  const char *dir = getenv("TMPDIR");
+  if (!dir || !*dir)
+    dir = "/tmp";
+  vector<char> path(strlen(dir) + 32);
+  snprintf(path.data(), path.size(), "%s/quienny-XXXXXX", dir);
+  const int fd = mkstemp(path.data());
+  if (fd < 0)
+    die("can not create temporary file in '%s'", dir);
+  unlink(path.data());
+  FILE *res = fdopen(fd, "w+");
+  if (!res)
+    die("can not open temporary file in '%s'", dir);
+  setvbuf(res, 0, _IOFBF, 1 << 20);
+  return res;
+}
+
+template <class bitvector>
+static void append(sequence &s, const polynomial<bitvector> &p) {
+  if (!s.file)
+    s.file = temporary();
+  p.print(s.file, true);
+  if (ferror(s.file))
+    die("can not write temporary file");
+  s.size += p.size();
+}
+
+template <class bitvector>
+static sequence spill(const polynomial<bitvector> &p) {
+  sequence res;
+  append(res, p);
+  return res;
+}
+
+static void close(sequence &s) {
+  if (s.file)
+    fclose(s.file);
+  s.file = 0, s.size = 0;
+}
+
+template <class bitvector> struct reader {
+  monomial<bitvector> current;
+  FILE *file;
+  size_t remaining;
+  vector<unsigned char> bytes;
+  reader(const sequence &s)
+      : file(s.file), remaining(s.size), bytes(2 * binary_bytes()) {
+    if (file)
+      rewind(file);
+  }
+  bool read() {
+    if (!remaining)
+      return false;
+    remaining--;
+    if (fread(bytes.data(), 1, bytes.size(), file) != bytes.size())
+      die("can not read temporary file");
+    current.decode(bytes.data());
+    return true;
+  }
+};
+
+// Merge sorted 'sequences' (and close them) passing each monomial once in
+// sorted order to 'sink'.
+
+template <class bitvector, class consumer>
+static void combine(vector<sequence> &sequences, consumer sink) {
+  vector<reader<bitvector>> readers;
+  for (const auto &s : sequences)
+    readers.emplace_back(s);
+  auto larger = [&](size_t i, size_t j) {
+    return readers[j].current < readers[i].current;
+  };
+  vector<size_t> heap;
+  for (size_t i = 0; i != readers.size(); i++)
+    if (readers[i].read())
+      heap.push_back(i);
+  make_heap(heap.begin(), heap.end(), larger);
+  monomial<bitvector> last;
+  bool first = true;
+  while (!heap.empty()) {
+    pop_heap(heap.begin(), heap.end(), larger);
+    const size_t i = heap.back();
+    const auto &m = readers[i].current;
+    if (first || m != last)
+      sink(m), last = m, first = false;
+    if (readers[i].read())
+      push_heap(heap.begin(), heap.end(), larger);
+    else
+      heap.pop_back();
+  }
+  for (auto &s : sequences)
+    close(s);
+  sequences.clear();
+}
+
+// Buffers monomials in memory and appends them in chunks to a sequence.
+
+template <class bitvector> struct collector {
+  sequence &target;
+  polynomial<bitvector> buffer;
+  collector(sequence &s) : target(s) {}
+  void add(const monomial<bitvector> &m) {
+    buffer.add(m);
+    if (buffer.size() == 1 << 14)
+      flush();
+  }
+  void flush() {
+    append(target, buffer);
+    buffer.clear();
+  }
+};
+
+// Approximately the maximum number of monomials kept in memory.
+
+template <class bitvector> static size_t capacity() {
+  size_t bytes = sizeof(monomial<bitvector>);
+  if (!bitvector::bytes)
+    bytes += 2 * binary_bytes();
+  return max((external << 20) / bytes, (size_t)1 << 10);
+}
+
+template <class bitvector>
+static void copy(const sequence &s, FILE *file) {
+  polynomial<bitvector> buffer;
+  reader<bitvector> input(s);
+  while (input.read()) {
+    buffer.add(input.current);
+    if (buffer.size() == 1 << 14)
+      buffer.print(file, true), buffer.clear();
+  }
+  buffer.print(file, true);
+}
+
+template <class bitvector>
+static void write_partial(const sequence &p, const sequence &primes,
+                          size_t round) {
+  if (!partial_path)
+    return;
+  FILE *file = open_partial(round, p.size, primes.size);
+  copy<bitvector>(p, file);
+  copy<bitvector>(primes, file);
+  close_partial(file, round, p.size, primes.size);
+}
+
+template <class bitvector>
+static sequence sorted(vector<sequence> &runs) {
+  sequence res;
+  collector<bitvector> output(res);
+  combine<bitvector>(runs,
+                     [&](const monomial<bitvector> &m) { output.add(m); });
+  output.flush();
+  if (!res.file)
+    res.file = temporary();
+  return res;
+}
+
+template <class bitvector> static void generate(sequence &p) {
+
+  const size_t limit = capacity<bitvector>();
+
+  flags merged;                 // Which monomials of 'pair' were merged?
+  polynomial<bitvector> pair;   // Two subsequent blocks of 'p'.
+  polynomial<bitvector> rest;   // Used to remove the first block.
+  polynomial<bitvector> next;   // Merged monomials not spilled yet.
+  vector<sequence> runs;        // Sorted spilled parts of 'next'.
+  vector<sequence> primes;      // Sorted primes of each round.
+
+#ifndef NOPTIMIZE
+  vector<task> tasks;
+  vector<worker<bitvector>> workers;
+#endif
+
+  size_t round = 0;
+  size_t completed = 0; // Rounds before the abandoned one.
+
+  while (p.size && !exceeding()) {
+
+    round++;
+    verbose("round %zu polynomial with %zu monomials", round, p.size);
+
+    primes.push_back(sequence());
+    collector<bitvector> found(primes.back());
+
+    // Move the not merged monomials among the first 'block' monomials in
+    // 'pair' to the primes (or print them when streaming).
+
+    auto complete = [&](size_t block) {
+      for (size_t i = 0; i != block; i++)
+        if (!merged[i]) {
+          if (streaming)
+            rest.add(pair[i]);
+          else
+            found.add(pair[i]);
+        }
+      if (streaming) {
+        rest.print(output_file), fflush(output_file);
+        streamed += rest.size();
+        rest.clear();
+      }
+    };
+
+    reader<bitvector> input(p);
+    bool more = input.read();
+    pair.clear(), merged.clear(), next.clear();
+
+    while (more && !exceeding()) {
+
+      const size_t begin_second_block = pair.size();
+      const size_t ones = input.current.ones;
+      do
+        pair.add(input.current);
+      while ((more = input.read()) && input.current.ones == ones);
+      merged.resize(pair.size());
+
+      if (!begin_second_block)
+        continue;
+
+      const size_t end_second_block = pair.size();
+      if ((size_t)pair[0].ones + 1 == ones) {
+#ifdef NOPTIMIZE
+        profiled scope(MATCHING);
+        for (size_t i = 0; i != begin_second_block; i++)
+          for (size_t j = begin_second_block; j != end_second_block; j++)
+            consensus(pair[i], pair[j], merged, i, j, next);
+#else
+        tasks.clear();
+        schedule(pair, 0, begin_second_block, end_second_block, tasks);
+        execute(pair, tasks, merged, workers, next);
+#endif
+      }
+
+      if (exceeded)
+        break;
+
+      complete(begin_second_block);
+
+      rest.clear();
+      for (size_t i = begin_second_block; i != end_second_block; i++)
+        rest.add(pair[i]);
+      pair.swap(rest);
+      rest.clear();
+      merged.drop(begin_second_block);
+
+      if (next.size() > limit) {
+        next.normalize();
+        runs.push_back(spill(next));
+        next.clear();
+      }
+    }
+
+    if (exceeded) { // Abandon this round but keep 'p'.
+      for (auto &r : runs)
+        close(r);
+      runs.clear();
+      close(primes.back());
+      primes.pop_back();
+      break;
+    }
+
+    complete(pair.size());
+    found.flush();
+
+    close(p);
+    next.normalize();
+    runs.push_back(spill(next));
+    next.clear();
+    verbose("merging %zu sorted runs", runs.size());
+    p = sorted<bitvector>(runs);
+    completed = round;
+  }
+
+  // The partial checkpoint needs the number of primes first, thus the
+  // primes of all rounds are merged into one sequence before.
+
+  if (exceeded && partial_path) {
+    sequence found = sorted<bitvector>(primes);
+    write_partial<bitvector>(p, found, completed);
+    primes.push_back(found);
+  }
+  close(p);
+
+  if (streaming)
+    return;
+
+  polynomial<bitvector> output;
+  size_t printed = 0;
+  combine<bitvector>(primes, [&](const monomial<bitvector> &m) {
+    output.add(m);
+    if (output.size() == 1 << 14)
+      output.print(output_file), printed += output.size(), output.clear();
+  });
+  output.print(output_file), printed += output.size();
+  verbose("primes polynomial with %zu monomials", printed);
+}
+
+// Parse the input in chunks which are sorted and spilled separately.
+
+template <class bitvector>
+static void run_external(const monomial<generic> *first) {
+  const size_t limit = capacity<bitvector>();
+  verbose("external memory mode with at most %zu monomials in memory", limit);
+  vector<sequence> runs;
+  if (first) {
+    polynomial<bitvector> chunk;
+    monomial<bitvector> m(*first);
+    const auto add = [&](const monomial<bitvector> &m) {
+      chunk.add(m);
+      if (chunk.size() == limit) {
+        chunk.normalize();
+        runs.push_back(spill(chunk));
+        chunk.clear();
+      }
+    };
+    do
+      expand(m, add);
+    while (m.parse_remaining());
+    chunk.normalize();
+    runs.push_back(spill(chunk));
+  }
+  sequence p = sorted<bitvector>(runs);
+  if (binary_output)
+    print_binary_header(output_file);
+  generate<bitvector>(p);
+  verbose("compared %zu monomials", compared);
+  verbose("looked up %zu flipped monomials", looked_up);
+  if (streaming)
+    verbose("streamed %zu primes", streamed);
+}
+
+//------------------------------------------------------------------------//
+
+// Don't-cares ('-d <file>') are read after the on-set from a second file in
+// the same format (minterms or cubes) and with the same number of variables.
+// They are added to the minterms with 'care' cleared.
+
+static thread_local const char *dont_care_path; // Set by '-d <file>'.
+
+static void open_dont_cares() {
+  if (close_input)
+    fclose(input_file);
+  reset_reading();
+  input_path = dont_care_path;
+  if (!strcmp(input_path, "-"))
+    input_path = "<stdin>", input_file = stdin, close_input = false;
+  else if (!(input_file = fopen(input_path, "r")))
+    die("can not read '%s'", input_path);
+  else
+    close_input = true;
+  init_reading();
+  if (!binary_input)
+    return;
+  const unsigned char *header = read_bytes(16);
+  if (!header)
+    parse_error("unexpected end-of-file (expected binary header)");
+  if (memcmp(header, binary_magic, sizeof binary_magic))
+    parse_error("invalid binary header (try '-h')");
+  const uint64_t n = decode_number(header + 8);
+  if (n != variables)
+    parse_error("expected %zu variables but got '%" PRIu64 "'",
+                (size_t)variables, n);
+}
+
+template <class bitvector>
+static void parse_dont_cares(polynomial<bitvector> &p) {
+  profiled scope(PARSING);
+  open_dont_cares();
+  const size_t before = p.size();
+  const auto add = [&p](const monomial<bitvector> &m) { p.add(m); };
+  monomial<bitvector> m = p[0]; // To get properly sized bit-vectors.
+  m.care = false;
+  while (m.parse_remaining())
+    expand(m, add);
+  verbose("parsed %zu don't-care minterms", p.size() - before);
+}
+
+//------------------------------------------------------------------------//
+
+// Iterated consensus ('--consensus') computes all primes from an arbitrary
+// cover of cubes, thus with effort depending on the size of the cover and
+// the number of primes, instead of on the number of minterms as in the
+// Quine-McCluskey rounds of 'generate'.  For each variable 'x' in turn all
+// pairs of cubes with literals 'x' and '!x' are resolved and the consensus
+// is added unless it is contained in another cube, while the cubes it
+// contains are absorbed.  By Tison's theorem the remaining cubes after the
+// last variable are exactly the primes.  With don't-cares primes which do
+// not intersect any on-set cube are dropped at the end.
+
+template <class bitvector>
+static void run_consensus(const monomial<generic> *first) {
+  double start = now();
+  polynomial<bitvector> input, primes;
+  if (first) {
+    input.parse(monomial<bitvector>(*first));
+    if (dont_care_path)
+      parse_dont_cares(input);
+  }
+  parsing = now() - start, start += parsing;
+  input.normalize();
+  normalizing = now() - start;
+  verbose("iterated consensus on %zu cubes", input.size());
+
+  vector<monomial<bitvector>> cubes;
+  vector<unsigned char> absorbed;
+  vector<size_t> negative, positive, candidates;
+  size_t added = 0;
+
+  // Only 'candidates' can contain 'c' (in a pass over 'x' those without a
+  // literal on 'x'), while all cubes contained in 'c' are absorbed.
+
+  const auto insert = [&](const monomial<bitvector> &c) {
+    for (auto j : candidates)
+      if (!absorbed[j] && cubes[j].contains(c))
+        return;
+    for (size_t j = 0; j != cubes.size(); j++)
+      if (!absorbed[j] && c.contains(cubes[j]))
+        absorbed[j] = 1;
+    candidates.push_back(cubes.size());
+    cubes.push_back(c);
+    absorbed.push_back(0);
+    added++;
+  };
+
+  for (size_t i = 0; i != input.size(); i++)
+    insert(input[i]);
+
+  monomial<bitvector> c;
+  profiled scope(ITERATING);
+  for (auto x : variables) {
+    if (exceeding())
+      break;
+    size_t j = 0;
+    for (size_t i = 0; i != cubes.size(); i++)
+      if (!absorbed[i])
+        cubes[j++] = cubes[i];
+    cubes.resize(j);
+    absorbed.assign(j, 0);
+    negative.clear(), positive.clear(), candidates.clear();
+    for (size_t i = 0; i != cubes.size(); i++)
+      if (!cubes[i].mask.get(x))
+        candidates.push_back(i);
+      else if (cubes[i].values.get(x))
+        positive.push_back(i);
+      else
+        negative.push_back(i);
+    for (auto i : negative)
+      for (auto j : positive) {
+        if (absorbed[i])
+          break;
+        if (absorbed[j])
+          continue;
+        compared++;
+        if (cubes[i].consensus(cubes[j], c))
+          insert(c);
+      }
+  }
+  verbose("compared %zu cubes", compared);
+  verbose("added %zu cubes", added);
+  if (exceeded)
+    return;
+
+  start = now();
+  for (size_t i = 0; i != cubes.size(); i++) {
+    if (absorbed[i])
+      continue;
+    bool care = !dont_care_path;
+    for (size_t j = 0; !care && j != input.size(); j++)
+      care = input[j].care && cubes[i].intersects(input[j]);
+    if (care)
+      primes.add(cubes[i]);
+  }
+  primes.normalize();
+  verbose("primes polynomial with %zu monomials", primes.size());
+  if (binary_output)
+    print_binary_header(output_file);
+  report(primes);
+  finishing = now() - start;
+}
+
+//------------------------------------------------------------------------//
+
+// With '--cover' only a small subset of the primes covering all on-set
+// minterms is written.  The covering table has a row for each prime and a
+// column for each minterm, stored as sorted index lists in both directions.
+// Rows are filled by enumerating the minterms of each prime and looking
+// them up in the sorted minterms, or by checking all minterms if the prime
+// has more minterms than there are.  Then the classic reductions are
+// applied until fix-point: selecting essential primes (rows of columns with
+// a single remaining row), removing dominated rows (covering a subset of
+// the columns of another row) and dominating columns (covered whenever
+// another column is covered).  If columns remain the row covering most of
+// them is picked greedily and the reductions are repeated.  Finally
+// selected primes which became redundant are removed again.
+
+static thread_local bool covering; // Set by '--cover'.
+
+// Index lists of the covering table are stored consecutively in 'elements'
+// with list 'i' starting at 'start[i]'.
+
+struct lists {
+  struct range {
+    const size_t *first, *last;
+    const size_t *begin() const { return first; }
+    const size_t *end() const { return last; }
+  };
+  vector<size_t> start = {0}, elements;
+  range operator[](size_t i) const {
+    return {elements.data() + start[i], elements.data() + start[i + 1]};
+  }
+  size_t size(size_t i) const { return start[i + 1] - start[i]; }
+};
+
+template <class bitvector>
+static void cover(const polynomial<bitvector> &minterms,
+                  polynomial<bitvector> &primes) {
+
+  profiled scope(COVERING);
+  const size_t m = minterms.size(), n = primes.size();
+  lists rows, columns;
+
+  const auto lookup = [&](const monomial<bitvector> &minterm) {
+    size_t l = 0, r = m;
+    while (l < r) {
+      const size_t mid = l + (r - l) / 2;
+      if (minterms[mid] < minterm)
+        l = mid + 1;
+      else
+        r = mid;
+    }
+    return l != m && minterms[l] == minterm ? l : m;
+  };
+
+  vector<size_t> &row = rows.elements;
+  for (size_t i = 0; i != n; i++) {
+    const monomial<bitvector> p = primes[i];
+    const size_t dashes = variables - p.mask.count();
+    if (dashes < 8 * sizeof(size_t) - 1 && (size_t)1 << dashes <= m)
+      expand(p, [&](const monomial<bitvector> &minterm) {
+        const size_t j = lookup(minterm);
+        if (j != m) // Otherwise a don't-care.
+          row.push_back(j);
+      });
+    else
+      for (size_t j = 0; j != m; j++)
+        if (p.contains(minterms[j]))
+          row.push_back(j);
+    sort(row.begin() + rows.start.back(), row.end());
+    rows.start.push_back(row.size());
+  }
+
+  columns.start.assign(m + 1, 0);
+  for (auto j : row)
+    columns.start[j + 1]++;
+  for (size_t j = 0; j != m; j++)
+    columns.start[j + 1] += columns.start[j];
+  columns.elements.resize(row.size());
+  {
+    vector<size_t> filled(columns.start.begin(), columns.start.end() - 1);
+    for (size_t i = 0; i != n; i++)
+      for (auto j : rows[i])
+        columns.elements[filled[j]++] = i;
+  }
+
+  // Rows are 'alive' unless selected or removed and columns unless covered
+  // or dominating.  The sizes count only alive rows and columns.  Rows and
+  // columns which lost elements are 'dirty' and only those have to be
+  // checked again for dominance.  For the greedy selection rows are kept
+  // in buckets by size (lazily, since sizes only decrease).
+
+  vector<unsigned char> selected(n), removed(n), done(m);
+  vector<size_t> row_size(n), column_size(m), order;
+  vector<unsigned char> dirty_row(n, 1), dirty_column(m, 1);
+  vector<size_t> dirty_rows(n), dirty_columns(m);
+  size_t largest = 0;
+  for (size_t i = 0; i != n; i++)
+    row_size[i] = rows.size(i), dirty_rows[i] = i;
+  for (size_t j = 0; j != m; j++)
+    column_size[j] = columns.size(j), dirty_columns[j] = j;
+  for (size_t i = 0; i != n; i++)
+    largest = max(largest, row_size[i]);
+  vector<vector<size_t>> buckets(largest + 1);
+  for (size_t i = n; i--;)
+    buckets[row_size[i]].push_back(i);
+  size_t remaining = m, essential = 0, dominated = 0, dominating = 0;
+  size_t greedy = 0;
+
+  const auto alive = [&](size_t i) { return !selected[i] && !removed[i]; };
+  const auto live_column = [&](size_t j) { return !done[j]; };
+
+  const auto shrink_row = [&](size_t i) {
+    buckets[--row_size[i]].push_back(i);
+    if (!dirty_row[i])
+      dirty_row[i] = 1, dirty_rows.push_back(i);
+  };
+
+  const auto shrink_column = [&](size_t j) {
+    column_size[j]--;
+    if (!dirty_column[j])
+      dirty_column[j] = 1, dirty_columns.push_back(j);
+  };
+
+  const auto select = [&](size_t i) {
+    selected[i] = 1, order.push_back(i);
+    for (auto j : rows[i])
+      if (!done[j]) {
+        done[j] = 1, remaining--;
+        for (auto k : columns[j])
+          if (alive(k))
+            shrink_row(k);
+      }
+  };
+
+  const auto remove = [&](size_t i) {
+    removed[i] = 1;
+    for (auto j : rows[i])
+      if (!done[j])
+        shrink_column(j);
+  };
+
+  const auto drop = [&](size_t j) {
+    done[j] = 1, remaining--;
+    for (auto i : columns[j])
+      if (alive(i))
+        shrink_row(i);
+  };
+
+  // Check whether the alive elements of 'a' are all in 'b' (both sorted).
+
+  const auto subset = [](const lists::range &a, const lists::range &b,
+                         const auto &alive) {
+    auto k = b.begin();
+    for (auto e : a) {
+      if (!alive(e))
+        continue;
+      while (k != b.end() && *k < e)
+        k++;
+      if (k == b.end() || *k != e)
+        return false;
+    }
+    return true;
+  };
+
+  // Rows only covering columns of another row are removed.
+
+  const auto check_row = [&](size_t i) {
+    if (!row_size[i]) {
+      remove(i);
+      return;
+    }
+    size_t best = m;
+    for (auto j : rows[i])
+      if (!done[j] && (best == m || column_size[j] < column_size[best]))
+        best = j;
+    for (auto k : columns[best])
+      if (k != i && alive(k) && row_size[k] >= row_size[i] &&
+          (row_size[k] > row_size[i] || k < i) &&
+          subset(rows[i], rows[k], live_column)) {
+        remove(i), dominated++;
+        return;
+      }
+  };
+
+  // The row of a column with a single row is essential.  Columns covered
+  // whenever column 'j' is covered are dropped.
+
+  const auto check_column = [&](size_t j) {
+    size_t best = n;
+    for (auto i : columns[j])
+      if (alive(i) && (best == n || row_size[i] < row_size[best]))
+        best = i;
+    assert(best != n);
+    if (column_size[j] == 1) {
+      select(best), essential++;
+      return;
+    }
+    for (auto k : rows[best])
+      if (k != j && !done[k] && column_size[k] >= column_size[j] &&
+          (column_size[k] > column_size[j] || k > j) &&
+          subset(columns[j], columns[k], alive))
+        drop(k), dominating++;
+  };
+
+  while (remaining && !exceeding()) {
+    if (!dirty_columns.empty()) {
+      const size_t j = dirty_columns.back();
+      dirty_columns.pop_back(), dirty_column[j] = 0;
+      if (!done[j])
+        check_column(j);
+    } else if (!dirty_rows.empty()) {
+      const size_t i = dirty_rows.back();
+      dirty_rows.pop_back(), dirty_row[i] = 0;
+      if (alive(i))
+        check_row(i);
+    } else {
+      while (largest && buckets[largest].empty())
+        largest--;
+      assert(largest);
+      const size_t i = buckets[largest].back();
+      buckets[largest].pop_back();
+      if (alive(i) && row_size[i] == largest)
+        select(i), greedy++;
+    }
+  }
+
+  verbose("covering %zu minterms with %zu primes: %zu essential, "
+          "%zu dominated, %zu dominating, %zu greedy",
+          m, n, essential, dominated, dominating, greedy);
+  if (exceeded)
+    return;
+
+  vector<size_t> count(m);
+  for (auto i : order)
+    for (auto j : rows[i])
+      count[j]++;
+  size_t redundant = 0;
+  for (size_t k = order.size(); k--;) {
+    const size_t i = order[k];
+    bool needed = false;
+    for (auto j : rows[i])
+      if (count[j] == 1)
+        needed = true;
+    if (needed)
+      continue;
+    for (auto j : rows[i])
+      count[j]--;
+    selected[i] = 0, redundant++;
+  }
+  verbose("removed %zu redundant primes", redundant);
+
+  polynomial<bitvector> res;
+  for (size_t i = 0; i != n; i++)
+    if (selected[i])
+      res.add(primes[i]);
+  primes.swap(res);
+  verbose("cover with %zu primes", primes.size());
+}
+
+//------------------------------------------------------------------------//
+
+// The kernels are instantiations of 'generate' for all bit-vector types.
+// The first one in this table supporting enough variables is picked if no
+// particular kernel has been forced with '-k <kernel>'.
+
+// Parsing the first monomial with the 'generic' bit-vector determines the
+// number of variables, and is then converted to the chosen bit-vector type
+// before parsing the remaining monomials.
+
+template <class bitvector> static void run(const monomial<generic> *first) {
+  if (external) {
+    run_external<bitvector>(first);
+    return;
+  }
+  if (iterated) {
+    run_consensus<bitvector>(first);
+    return;
+  }
+  double start = now();
+  polynomial<bitvector> minterms, primes;
+  if (resume_path)
+    parse_checkpoint(minterms, primes);
+  else if (first) {
+    minterms.parse(monomial<bitvector>(*first));
+    if (dont_care_path)
+      parse_dont_cares(minterms);
+  }
+  parsing = now() - start, start += parsing;
+  minterms.normalize();
+  normalizing = now() - start;
+  polynomial<bitvector> onset; // Minterms to be covered with '--cover'.
+  if (covering)
+    for (size_t i = 0; i != minterms.size(); i++)
+      if (minterms[i].care)
+        onset.add(minterms[i]);
+  if (binary_output)
+    print_binary_header(output_file);
+  generate(minterms, primes);
+  verbose("compared %zu monomials", compared);
+  verbose("looked up %zu flipped monomials", looked_up);
+  if (streaming) {
+    primes.print(output_file); // Resumed from a completed checkpoint.
+    streamed += primes.size();
+    verbose("streamed %zu primes", streamed);
+    return;
+  }
+  start = now();
+  primes.normalize();
+  verbose("primes polynomial with %zu monomials", primes.size());
+  if (covering && !exceeded)
+    cover(onset, primes);
+  report(primes);
+  finishing = now() - start;
+}
+
+struct kernel {
+  const char *name;
+  size_t max_variables;
+  void (*run)(const monomial<generic> *);
+};
+
+static const kernel kernels[] = {
+    {"8", fixed<uint8_t>::max_variables, run<fixed<uint8_t>>},
+    {"16", fixed<uint16_t>::max_variables, run<fixed<uint16_t>>},
+    {"32", fixed<uint32_t>::max_variables, run<fixed<uint32_t>>},
+    {"64", fixed<uint64_t>::max_variables, run<fixed<uint64_t>>},
+    {"128", words<2>::max_variables, run<words<2>>},
+    {"256", words<4>::max_variables, run<words<4>>},
+    {"512", words<8>::max_variables, run<words<8>>},
+    {"generic", generic::max_variables, run<generic>},
+};
+
+static thread_local const kernel *forced_kernel; // Set by '-k <kernel>'.
+
+static const kernel *find_kernel(const char *name) {
+  for (const auto &k : kernels)
+    if (!strcmp(k.name, name))
+      return &k;
+  return 0;
+}
+
+static const kernel &select_kernel() {
+  if (forced_kernel) {
+    if (variables > forced_kernel->max_variables)
+      die("kernel '%s' supports at most %zu variables (but got %zu)",
+          forced_kernel->name, forced_kernel->max_variables,
+          (size_t)variables);
+    return *forced_kernel;
+  }
+  const kernel *k = kernels;
+  while (variables > k->max_variables)
+    k++;
+  return *k;
+}
+
+//------------------------------------------------------------------------//
+
+// With '--batch' the input consists of many functions, each terminated by
+// an empty line (or the end of the input).  The input is read completely
+// and split into functions, which are then parsed and solved concurrently
+// by '-t <threads>' threads (each function by a single thread), picking the
+// next function from a shared counter as in 'execute'.  For many small
+// functions this balances the load as well as work stealing would.  The
+// primes of each function are collected in a string and written in input
+// order by the main thread, each set of primes again terminated by an empty
+// line.  Thus the output is valid '--batch' input.
+
+static thread_local bool batching; // Set by '--batch'.
+
+static context save() {
+  context c;
+  c.input_path = input_path, c.output_path = output_path;
+  c.binary_input = binary_input, c.binary_output = binary_output;
+  c.verbosity = verbosity;
+  c.forced_kernel = forced_kernel;
+  c.normalization = normalization;
+  c.matching = matching;
+  c.simd = simd;
+  c.hits32 = batch<uint32_t>::hits, c.hits64 = batch<uint64_t>::hits;
+  c.threads = threads;
+  c.external = external;
+  c.dont_care_path = dont_care_path;
+  c.streaming = streaming, c.pipelining = pipelining, c.iterated = iterated;
+  c.covering = covering, c.batching = batching, c.stats = stats;
+  c.time_limit = time_limit;
+  c.memory_limit = memory_limit;
+  c.checkpoint_path = checkpoint_path, c.resume_path = resume_path;
+  c.partial_path = partial_path, c.stats_path = stats_path;
+  c.started = started;
+  c.variables = variables;
+  c.outputs = outputs;
+  c.bytes = pool::bytes, c.chunks = pool::chunks;
+  return c;
+}
+
+static void restore(const context &c) {
+  input_path = c.input_path, output_path = c.output_path;
+  binary_input = c.binary_input, binary_output = c.binary_output;
+  verbosity = c.verbosity;
+  forced_kernel = c.forced_kernel;
+  normalization = c.normalization;
+  matching = c.matching;
+  simd = c.simd;
+  batch<uint32_t>::hits = c.hits32, batch<uint64_t>::hits = c.hits64;
+  threads = c.threads;
+  external = c.external;
+  dont_care_path = c.dont_care_path;
+  streaming = c.streaming, pipelining = c.pipelining, iterated = c.iterated;
+  covering = c.covering, batching = c.batching, stats = c.stats;
+  time_limit = c.time_limit;
+  memory_limit = c.memory_limit;
+  checkpoint_path = c.checkpoint_path, resume_path = c.resume_path;
+  partial_path = c.partial_path, stats_path = c.stats_path;
+  started = c.started;
+  variables = c.variables;
+  outputs = c.outputs;
+  pool::bytes = c.bytes, pool::chunks = c.chunks;
+}
+
+#ifndef LIBRARY
+
+struct job {
+  const char *begin, *end; // Lines of the function.
+  size_t lineno;           // Line number of 'begin' for parse errors.
+};
+
+static void solve(const job &j, string &primes) {
+  cursor = j.begin, limit = j.end, exhausted = true, lineno = j.lineno;
+  variables.size = outputs = 0, compared = looked_up = 0;
+  const function<void(const char *)> collect = [&](const char *prime) {
+    primes += prime, primes += '\n';
+  };
+  reporting = &collect;
+  monomial<generic> first;
+  const bool parsed = first.parse_first();
+  select_kernel().run(parsed ? &first : 0);
+  reporting = 0;
+  primes += '\n';
+}
+
+static void run_batch() {
+  while (refill())
+    ;
+  vector<job> jobs;
+  const char *p = cursor;
+  size_t line = 1;
+  while (p != limit) {
+    job j = {p, limit, line};
+    for (;;) {
+      const char *eol = (const char *)memchr(p, '\n', limit - p);
+      if (!eol) {
+        p = j.end = limit; // Let the parser complain about the new-line.
+        break;
+      }
+      line++;
+      if (eol == p) {
+        j.end = p++;
+        break;
+      }
+      p = j.end = eol + 1;
+    }
+    jobs.push_back(j);
+  }
+  const size_t size = jobs.size();
+  const unsigned n = max(min((size_t)threads, size), (size_t)1);
+  verbose("batch of %zu functions with %u threads", size, n);
+  threads = 1; // Each function is solved by a single thread.
+
+  vector<string> outputs(size);
+  vector<unsigned char> solved(size);
+  mutex lock;
+  condition_variable ready;
+  atomic<size_t> scheduled(0);
+  atomic<int> status(0); // First exceeded limit of all threads.
+
+  vector<thread> running;
+  const context shared = save();
+  for (unsigned i = 0; i != n; i++)
+    running.emplace_back([&]() {
+      restore(shared);
+      size_t k;
+      while ((k = scheduled++) < size) {
+        solve(jobs[k], outputs[k]);
+        lock_guard<mutex> guard(lock);
+        solved[k] = 1;
+        ready.notify_all();
+      }
+      int expected = 0;
+      status.compare_exchange_strong(expected, exceeded);
+    });
+
+  for (size_t k = 0; k != size; k++) {
+    unique_lock<mutex> guard(lock);
+    ready.wait(guard, [&]() { return solved[k]; });
+    guard.unlock();
+    fwrite(outputs[k].data(), 1, outputs[k].size(), output_file);
+    string().swap(outputs[k]);
+  }
+  fflush(output_file);
+
+  for (auto &t : running)
+    t.join();
+
+  exceeded = status;
+}
+
+#endif
+
+//------------------------------------------------------------------------//
+
+// Output tags are only found while parsing the first monomial.  They are
+// not stored in binary records, and the other stages only support single
+// output functions.
+
+static void check_outputs() {
+  if (external || dont_care_path || binary_output || checkpoint_path ||
+      resume_path || partial_path || iterated || covering)
+    die("can not combine multiple outputs with '-e', '-d', '--binary-out', "
+        "'--checkpoint', '--resume', '--partial', '--consensus' or "
+        "'--cover'");
+}
+
+//------------------------------------------------------------------------//
+
+// Parse command line options (also used for the options of the library
+// engine) and set/reset input and output files.
+
+static void parse_options(int argc, char **argv) {
+
+  for (int i = 1; i != argc; i++) {
+    const char *arg = argv[i];
+    if (!strcmp(arg, "-h")) {
+#ifdef LIBRARY
+      die("option '-h' not supported by the library");
+#else
+      fputs(usage, stderr);
+      exit(1);
+#endif
+    } else if (!strcmp(arg, "-v"))
+      verbosity += verbosity >= 0 && (verbosity < INT_MAX);
+    else if (!strcmp(arg, "-k")) {
+      if (++i == argc)
+        die("argument to '-k' missing (try '-h')");
+      if (!(forced_kernel = find_kernel(argv[i])))
+        die("invalid kernel '%s' (try '-h')", argv[i]);
+    } else if (!strcmp(arg, "-n")) {
+      if (++i == argc)
+        die("argument to '-n' missing (try '-h')");
+      if (!strcmp(argv[i], "sort"))
+        normalization = SORT_NORMALIZATION;
+      else if (!strcmp(argv[i], "hash"))
+        normalization = HASH_NORMALIZATION;
+      else if (!strcmp(argv[i], "radix"))
+        normalization = RADIX_NORMALIZATION;
+      else
+        die("invalid normalization mode '%s' (try '-h')", argv[i]);
+    } else if (!strcmp(arg, "-m")) {
+      if (++i == argc)
+        die("argument to '-m' missing (try '-h')");
+      if (!strcmp(argv[i], "auto"))
+        matching = AUTO_MATCHING;
+      else if (!strcmp(argv[i], "pairs"))
+        matching = PAIRS_MATCHING;
+      else if (!strcmp(argv[i], "lookup"))
+        matching = LOOKUP_MATCHING;
+      else
+        die("invalid matching '%s' (try '-h')", argv[i]);
+    } else if (!strcmp(arg, "-s")) {
+      if (++i == argc)
+        die("argument to '-s' missing (try '-h')");
+      simd = argv[i];
+    } else if (!strcmp(arg, "-e")) {
+      if (++i == argc)
+        die("argument to '-e' missing (try '-h')");
+      const char *p = argv[i];
+      external = 0;
+      do
+        if (!isdigit(*p) || external > (SIZE_MAX >> 20) / 10 - 1)
+          die("invalid memory limit '%s' (try '-h')", argv[i]);
+        else
+          external = 10 * external + (*p - '0');
+      while (*++p);
+      if (!external)
+        die("invalid zero memory limit (try '-h')");
+    } else if (!strcmp(arg, "-d")) {
+      if (++i == argc)
+        die("argument to '-d' missing (try '-h')");
+      dont_care_path = argv[i];
+    } else if (!strcmp(arg, "-t")) {
+      if (++i == argc)
+        die("argument to '-t' missing (try '-h')");
+      const char *p = argv[i];
+      threads = 0;
+      do
+        if (!isdigit(*p) || threads > UINT_MAX / 10 - 1)
+          die("invalid number of threads '%s' (try '-h')", argv[i]);
+        else
+          threads = 10 * threads + (*p - '0');
+      while (*++p);
+      if (!threads)
+        die("invalid zero number of threads (try '-h')");
+    } else if (!strcmp(arg, "--binary-in"))
+      binary_input = true;
+    else if (!strcmp(arg, "--binary-out"))
+      binary_output = true;
+    else if (!strcmp(arg, "--stream"))
+      streaming = true;
+    else if (!strcmp(arg, "--pipeline"))
+      pipelining = true;
+    else if (!strcmp(arg, "--consensus"))
+      iterated = true;
+    else if (!strcmp(arg, "--batch"))
+      batching = true;
+    else if (!strcmp(arg, "--cover"))
+      covering = true;
+    else if (!strcmp(arg, "--stats"))
+      stats = true;
+    else if (!strcmp(arg, "--time-limit")) {
+      if (++i == argc)
+        die("argument to '--time-limit' missing (try '-h')");
+      char *end;
+      time_limit = strtod(argv[i], &end);
+      if (end == argv[i] || *end || !(time_limit > 0))
+        die("invalid time limit '%s' (try '-h')", argv[i]);
+    } else if (!strcmp(arg, "--memory-limit")) {
+      if (++i == argc)
+        die("argument to '--memory-limit' missing (try '-h')");
+      const char *p = argv[i];
+      memory_limit = 0;
+      do
+        if (!isdigit(*p) || memory_limit > (SIZE_MAX >> 20) / 10 - 1)
+          die("invalid memory limit '%s' (try '-h')", argv[i]);
+        else
+          memory_limit = 10 * memory_limit + (*p - '0');
+      while (*++p);
+      if (!memory_limit)
+        die("invalid zero memory limit (try '-h')");
+    } else if (!strcmp(arg, "--checkpoint")) {
+      if (++i == argc)
+        die("argument to '--checkpoint' missing (try '-h')");
+      checkpoint_path = argv[i];
+    } else if (!strcmp(arg, "--resume")) {
+      if (++i == argc)
+        die("argument to '--resume' missing (try '-h')");
+      resume_path = argv[i];
+    } else if (!strcmp(arg, "--partial")) {
+      if (++i == argc)
+        die("argument to '--partial' missing (try '-h')");
+      partial_path = argv[i];
+    } else if (!strcmp(arg, "--stats-json")) {
+      if (++i == argc)
+        die("argument to '--stats-json' missing (try '-h')");
+      stats_path = argv[i];
+    } else if (arg[0] == '-' && arg[1])
+      die("invalid option '%s' (try '-h')", arg);
+    else if (!input_path)
+      input_path = arg;
+    else if (!output_path)
+      output_path = arg;
+    else
+      die("too many files '%s', '%s', and '%s' (try '-h')", input_path,
+          output_path, arg);
+  }
+
+  if (external && (stats || stats_path))
+    die("can not combine '-e' with '--stats' or '--stats-json'");
+  if (external && (checkpoint_path || resume_path))
+    die("can not combine '-e' with '--checkpoint' or '--resume'");
+
+  if (iterated && (external || streaming || checkpoint_path || resume_path ||
+                   partial_path))
+    die("can not combine '--consensus' with '-e', '--stream', "
+        "'--checkpoint', '--resume' or '--partial'");
+
+  if (pipelining && (external || iterated))
+    die("can not combine '--pipeline' with '-e' or '--consensus'");
+
+  if (covering && (external || streaming || iterated || resume_path))
+    die("can not combine '--cover' with '-e', '--stream', '--consensus' "
+        "or '--resume'");
+
+  if (batching && (external || dont_care_path || binary_input ||
+                   binary_output || streaming || stats || stats_path ||
+                   checkpoint_path || resume_path || partial_path))
+    die("can not combine '--batch' with '-e', '-d', '--binary-in', "
+        "'--binary-out', '--stream', '--stats', '--stats-json', "
+        "'--checkpoint', '--resume' or '--partial'");
+
+  // Binary records written by these options do not contain the 'care' flag.
+
+  if (dont_care_path && (external || checkpoint_path || resume_path ||
+                         partial_path))
+    die("can not combine '-d' with '-e', '--checkpoint', '--resume' or "
+        "'--partial'");
+
+}
+
+#ifndef LIBRARY
+
+static void init(int argc, char **argv) {
+
+  parse_options(argc, argv);
+
+  // The checkpoint replaces the input, thus a single file is the output.
+
+  if (resume_path) {
+    if (output_path)
+      die("too many files '%s' and '%s' with '--resume' (try '-h')",
+          input_path, output_path);
+    output_path = input_path;
+    input_path = resume_path;
+    binary_input = true; // For error messages.
+  }
+
+  if (!input_path || (input_path && !strcmp(input_path, "-"))) {
+    if (dont_care_path && !strcmp(dont_care_path, "-"))
+      die("can not read both minterms and don't-cares from '<stdin>'");
+    input_path = "<stdin>", input_file = stdin;
+  } else if (!(input_file = fopen(input_path, "r")))
+    die("can not read '%s'", input_path);
+  else
+    close_input = true;
+
+  if (!output_path || (output_path && !strcmp(output_path, "-")))
+    output_path = "<stdin>", output_file = stdout;
+  else if (!(output_file = fopen(output_path, "w")))
+    die("can not write '%s'", output_path);
+  else
+    close_output = true;
+}
+
+static void reset(int argc) {
+  reset_reading();
+  pool::reset();
+  if (close_input)
+    fclose(input_file);
+  if (close_output)
+    fclose(output_file);
+}
+
+#endif
+
+/*------------------------------------------------------------------------*/
+
+#ifdef LIBRARY
+
+// Each library engine keeps its own options (parsed once by 'configure')
+// and its own pool in 'state'.  A call installs them in the calling thread
+// and its worker threads (see 'context') and converts the minterms directly
+// from the given strings.  No state is shared with other engines, thus
+// engines can be used by different threads concurrently.  The context and
+// run of the calling thread are saved and restored afterwards, which makes
+// it possible to call another engine from the function receiving primes.
+
+#include "quienny.h"
+
+struct quienny::engine::state {
+  context options;       // Parsed by 'configure'.
+  vector<void *> chunks; // Pool of this engine.
+  string message;        // Of the last error.
+};
+
+struct caller {
+  const context options = save();
+  const size_t compared = ::compared, looked_up = ::looked_up;
+  const int exceeded = ::exceeded;
+  vector<statistics> rounds = move(::rounds);
+  const double parsing = ::parsing, normalizing = ::normalizing;
+  const double finishing = ::finishing;
+  const function<void(const char *)> *const reporting = ::reporting;
+  const char *const *const given = ::given, *const *const given_end =
+                                                 ::given_end;
+  const size_t lineno = ::lineno;
+  void *const free_list = pool::free_list;
+  char *const top = pool::top, *const limit = pool::limit;
+  ~caller() {
+    restore(options);
+    ::compared = compared, ::looked_up = looked_up;
+    ::exceeded = exceeded;
+    ::rounds = move(rounds);
+    ::parsing = parsing, ::normalizing = normalizing;
+    ::finishing = finishing;
+    ::reporting = reporting;
+    ::given = given, ::given_end = given_end;
+    ::lineno = lineno;
+    pool::free_list = free_list, pool::top = top, pool::limit = limit;
+  }
+};
+
+namespace quienny {
+
+engine::engine() : internal(new state) {}
+
+engine::~engine() { delete internal; }
+
+status engine::configure(const vector<string> &options) {
+  caller saved;
+  restore(context()); // Default options.
+  internal->message.clear();
+  try {
+    vector<char *> argv = {(char *)"quienny"};
+    for (const auto &o : options)
+      argv.push_back((char *)o.c_str());
+    parse_options(argv.size(), argv.data());
+    if (input_path || external || dont_care_path || binary_input ||
+        binary_output || streaming || batching || checkpoint_path ||
+        resume_path || partial_path || stats_path)
+      die("files, '-e', '-d', '--binary-in', '--binary-out', '--stream', "
+          "'--batch', '--checkpoint', '--resume', '--partial' and "
+          "'--stats-json' are not supported by the library");
+    select_simd();
+  } catch (const failure &f) {
+    internal->message = f.message;
+    return ERROR;
+  }
+  internal->options = save();
+  return OK;
+}
+
+status engine::generate(const char *const *minterms, size_t size,
+                        const function<void(const char *)> &prime) {
+  caller saved;
+  restore(internal->options);
+  started = now();
+  input_path = "<minterms>";
+  compared = looked_up = 0, exceeded = 0;
+  rounds.clear();
+  parsing = normalizing = finishing = 0;
+  reporting = &prime;
+  static const char *const none = 0; // Non-zero 'given' if 'size' is zero.
+  given = size ? minterms : &none, given_end = given + size, lineno = 0;
+  pool::free_list = 0, pool::top = pool::limit = 0;
+  internal->message.clear();
+  int res;
+  {
+    monomial<generic> first; // Not pooled, thus released after the pool.
+    try {
+      const bool parsed = first.parse_first();
+      const kernel &k = select_kernel();
+      pool::init((variables + 63) / 64 * sizeof(uint64_t), internal->chunks);
+      verbose("using kernel '%s' for %zu variables", k.name,
+              (size_t)variables);
+      k.run(parsed ? &first : 0);
+      print_statistics();
+      res = exceeded;
+    } catch (const failure &f) {
+      internal->message = f.message;
+      res = ERROR;
+    } catch (...) { // Thrown by 'prime'.
+      pool::reset();
+      throw;
+    }
+    pool::reset();
+  }
+  return (status)res;
+}
+
+status engine::generate(const vector<string> &minterms,
+                        vector<string> &primes) {
+  vector<const char *> strings;
+  for (const auto &m : minterms)
+    strings.push_back(m.c_str());
+  primes.clear();
+  return generate(strings.data(), strings.size(),
+                  [&](const char *p) { primes.push_back(p); });
+}
+
+const string &engine::error() const { return internal->message; }
+
+} // namespace quienny
+
+#else
+
+int main(int argc, char **argv) {
+  started = now();
+  init(argc, argv);
+  init_reading();
+  select_simd();
+  vector<void *> chunks; // Of the pool.
+  monomial<generic> first;
+  if (batching)
+    run_batch(); // Without pool, since the number of variables differs.
+  else {
+    bool parsed = false;
+    if (resume_path)
+      parse_checkpoint_header();
+    else
+      parsed = first.parse_first();
+    const kernel &k = select_kernel();
+    pool::init((variables + 63) / 64 * sizeof(uint64_t), chunks);
+    verbose("using kernel '%s' for %zu variables", k.name,
+            (size_t)variables);
+    k.run(parsed ? &first : 0);
+    print_statistics();
+  }
+  print_profile();
+  reset(argc);
+  if (exceeded)
+    verbose("%s limit exceeded", exceeded == TIME_LIMIT_EXCEEDED ? "time"
+                                                                  : "memory");
+  return exceeded;
+}
+
+#endif
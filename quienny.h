@@ -0,0 +1,74 @@
+/*------------------------------------------------------------------------*/
+/* Copyright (c) 2024, Armin Biere, University of Freiburg, Germany       */
+/*------------------------------------------------------------------------*/
+
+#ifndef _quienny_h_INCLUDED
+#define _quienny_h_INCLUDED
+
+// Library interface of 'quienny' ('libquienny.a' built by 'make').  An
+// engine generates the primes of many functions within one process, without
+// forking 'quienny' and writing and parsing files for each of them.
+
+// Minterms (or cubes) are given as strings of '0', '1' and '-' characters
+// of the same length, exactly as the lines of the input file, and primes
+// are returned in the same format (sorted as in the output file).  Options
+// are the command line options of 'quienny' without files, e.g., '-k 64',
+// '-t 4', '--cover' or '--time-limit 10'.
+
+// Errors (invalid options, minterms or too many variables for the forced
+// kernel) are returned as 'ERROR' with the message available in 'error'
+// instead of exiting.  If a limit is exceeded the primes of the completed
+// rounds are returned together with 'TIME_LIMIT' or 'MEMORY_LIMIT'.
+
+// Engines are independent.  Each keeps its own options (parsed once by
+// 'configure') and its own pool of monomials (released after each call),
+// while minterms are converted directly from the given strings.  Thus
+// different engines can generate primes concurrently from several threads
+// (and '-t <threads>' compares monomials in parallel within one call).  An
+// engine itself must only be used by one thread at a time, but 'prime' may
+// call another engine.  The vectors used within rounds are kept per thread.
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace quienny {
+
+enum status {
+  OK = 0,
+  ERROR = 1,
+  TIME_LIMIT = 2,  // Same as the exit codes of 'quienny'.
+  MEMORY_LIMIT = 3,
+};
+
+class engine {
+  struct state;
+  state *internal;
+
+public:
+  engine();
+  ~engine();
+  engine(const engine &) = delete;
+  engine &operator=(const engine &) = delete;
+
+  // Set options used for all following calls (replacing previous ones).
+
+  status configure(const std::vector<std::string> &options);
+
+  // Pass each prime of the 'size' minterms to 'prime' (the string is only
+  // valid during the call).
+
+  status generate(const char *const *minterms, size_t size,
+                  const std::function<void(const char *)> &prime);
+
+  status generate(const std::vector<std::string> &minterms,
+                  std::vector<std::string> &primes);
+
+  // The message of the last 'ERROR'.
+
+  const std::string &error() const;
+};
+
+} // namespace quienny
+
+#endif
@@ -0,0 +1,91 @@
+#include "quienny.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Generate the primes of '<pol>' with one engine several times (with
+// different options) and compare them to the lines of '<gld>'.  Then do the
+// same with engines running concurrently in several threads and with an
+// engine called while another one reports its primes.
+
+using namespace std;
+
+static vector<string> lines(const char *path) {
+  vector<string> res;
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return res;
+  string line;
+  int ch;
+  while ((ch = getc(file)) != EOF)
+    if (ch == '\n')
+      res.push_back(line), line.clear();
+    else
+      line.push_back(ch);
+  fclose(file);
+  return res;
+}
+
+static int failed(const char *what, const quienny::engine &e) {
+  fprintf(stderr, "api: %s failed: %s\n", what, e.error().c_str());
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3)
+    return 1;
+  const vector<string> minterms = lines(argv[1]), golden = lines(argv[2]);
+  quienny::engine e;
+  vector<string> primes;
+  const vector<vector<string>> options = {
+      {}, {"-k", "generic"}, {"-k", "512", "-m", "pairs"}, {"-t", "2"}};
+  for (const auto &o : options) {
+    if (e.configure(o) != quienny::OK)
+      return failed("configure", e);
+    for (int i = 0; i != 2; i++) {
+      if (e.generate(minterms, primes) != quienny::OK)
+        return failed("generate", e);
+      if (primes != golden)
+        return failed("comparing", e);
+    }
+  }
+  const int n = options.size();
+  vector<quienny::engine> engines(n);
+  vector<int> results(n);
+  vector<thread> threads;
+  for (int i = 0; i != n; i++)
+    threads.emplace_back([&, i]() {
+      quienny::engine &c = engines[i];
+      vector<string> p;
+      results[i] = c.configure(options[i]) != quienny::OK;
+      for (int j = 0; !results[i] && j != 10; j++)
+        results[i] = c.generate(minterms, p) != quienny::OK || p != golden;
+    });
+  for (auto &t : threads)
+    t.join();
+  for (int i = 0; i != n; i++)
+    if (results[i])
+      return failed("concurrent generate", engines[i]);
+  vector<const char *> strings;
+  for (const auto &m : minterms)
+    strings.push_back(m.c_str());
+  primes.clear();
+  bool nested = true;
+  if (e.generate(strings.data(), strings.size(), [&](const char *p) {
+        vector<string> q;
+        nested = nested && engines[0].generate(minterms, q) == quienny::OK &&
+                 q == golden;
+        primes.push_back(p);
+      }) != quienny::OK ||
+      !nested || primes != golden)
+    return failed("nested generate", e);
+  if (e.configure({"-e", "1"}) != quienny::ERROR)
+    return failed("rejecting '-e'", e);
+  if (e.generate({"01", "0x"}, primes) != quienny::ERROR ||
+      !strstr(e.error().c_str(), "parse error"))
+    return failed("rejecting invalid minterm", e);
+  return 0;
+}
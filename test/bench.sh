@@ -0,0 +1,67 @@
+#!/bin/sh
+die () {
+  echo "test/bench.sh: error: $*" 1>&2
+  exit 1
+}
+
+cd `dirname $0`/..
+
+# Benchmark 'quienny' variants and configurations on generated polynomials
+# and print one comma separated line per run to 'stdout' (progress goes to
+# 'stderr').  The sweeps can be changed through the environment variables
+# below, and 'COMPILE' is the compilation command from 'makefile'.
+
+sizes=${sizes:-"8 10 12 14"}         # For 'all', 'abo', 'abz' and 'atleast'.
+random=${random:-"12 16 18"}         # Variables of random polynomials.
+densities=${densities:-"10 50 90"}   # Percent of minterms in 'random'.
+kernels=${kernels:-"default 64 128 generic"}
+threads=${threads:-"1 2 4"}
+noptimize=${noptimize:-10}           # Largest size for 'NOPTIMIZE'.
+
+suite=bench
+programs="all abo abz gen"
+. test/variants.sh
+
+run_bench () {
+  out=$dir/$name.out
+  err=$dir/$name.err
+  measured $err $dir/quienny-$variant -v $run $pol $out
+  primes=`wc -l < $out`
+  compared=`sed -n -e 's,^.*compared \([0-9]*\) monomials$,\1,p' $err`
+  [ "$compared" ] || compared=0
+  looked_up=`sed -n -e 's,^.*looked up \([0-9]*\) flipped.*,\1,p' $err`
+  [ "$looked_up" ] || looked_up=0
+  rate=`awk "BEGIN { s = $seconds; if (s < 0.001) s = 0.001;
+                     printf \"%.0f\", $minterms / s }"`
+  echo "$variant,$kernel,$t,$name,$variables,$minterms,$primes,$compared,$looked_up,$seconds,$kilobytes,$rate"
+}
+
+bench () {
+  name=$1
+  pol=$dir/$name.pol
+  minterms=`wc -l < $pol`
+  sweep run_bench
+}
+
+echo "variant,kernel,threads,polynomial,variables,minterms,primes,compared,looked_up,seconds,kilobytes,minterms_per_second"
+
+for variables in $sizes
+do
+  for generator in all abo abz
+  do
+    test/$generator $variables > $dir/$generator$variables.pol
+    bench $generator$variables
+  done
+  test/gen atleast $variables > $dir/atleast$variables.pol
+  bench atleast$variables
+done
+
+for variables in $random
+do
+  for density in $densities
+  do
+    test/gen random $variables $density 1 > \
+      $dir/random$variables-$density.pol
+    bench random$variables-$density
+  done
+done
@@ -0,0 +1,89 @@
+#!/bin/sh
+die () {
+  echo "test/diff.sh: error: $*" 1>&2
+  exit 1
+}
+
+cd `dirname $0`/..
+
+# Differential testing of 'quienny' variants and configurations on
+# polynomials generated by 'gen'.  Every run has to produce exactly the same
+# primes as the first (default) run on the same polynomial, otherwise we
+# abort.  One comma separated line with the timing of each run is printed
+# to 'stdout' (progress goes to 'stderr').  The sweeps can be changed
+# through the environment variables below, and 'COMPILE' is the compilation
+# command from 'makefile'.
+
+families=${families:-"random cubes symmetric threshold atleast inc pow prime \
+add mul"}
+sizes=${sizes:-"6 10 12"}           # Variables of generated polynomials.
+densities=${densities:-"20 80"}     # Percent for the random families.
+seeds=${seeds:-"1 2"}               # Seeds for the random families.
+kernels=${kernels:-"default 16 64 128 generic"}
+threads=${threads:-"1 3"}
+modes=${modes:-"none --pipeline -n_hash -n_radix -m_pairs -m_lookup -e_1"}
+                                    # Options with '_' instead of spaces.
+noptimize=${noptimize:-10}          # Largest size for 'NOPTIMIZE'.
+
+suite=diff
+programs=gen
+. test/variants.sh
+
+run_modes () {
+  for mode in $modes
+  do
+    [ $variant = noptimize ] && [ $mode != none ] && continue
+    configuration="$run"
+    [ $mode = none ] || configuration="$configuration `echo $mode | tr _ ' '`"
+    out=$dir/$name.out
+    err=$dir/$name.err
+    measured $err $dir/quienny-$variant $configuration $pol $out
+    if [ -f $gld ]
+    then
+      cmp -s $out $gld || \
+        die "'$dir/quienny-$variant $configuration $pol' differs from '$gld'"
+    else
+      cp $out $gld || die "could not copy '$out'"
+    fi
+    primes=`wc -l < $out`
+    echo "$variant,$kernel,$t,$mode,$name,$variables,$minterms,$primes,$seconds,$kilobytes"
+  done
+}
+
+check () {
+  name=$1
+  pol=$dir/$name.pol
+  gld=$dir/$name.gld
+  minterms=`wc -l < $pol`
+  rm -f $gld
+  sweep run_modes
+}
+
+echo "variant,kernel,threads,mode,polynomial,variables,minterms,primes,seconds,kilobytes"
+
+for variables in $sizes
+do
+  for family in $families
+  do
+    case $family in
+      random|cubes|symmetric|threshold)
+        for density in $densities
+        do
+          for seed in $seeds
+          do
+            name=$family$variables-$density-$seed
+            test/gen $family $variables $density $seed > $dir/$name.pol || \
+              die "'test/gen $family $variables $density $seed' failed"
+            check $name
+          done
+        done
+        ;;
+      *)
+        name=$family$variables
+        test/gen $family $variables > $dir/$name.pol || \
+          die "'test/gen $family $variables' failed"
+        check $name
+        ;;
+    esac
+  done
+done
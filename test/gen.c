@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Generate functions over 'n' variables of the following families:
+//
+//   random     each minterm with 'percent' probability
+//   cubes      '4 n' random cubes with a '-' with 'percent' probability
+//   symmetric  each number of true variables with 'percent' probability
+//   threshold  random weights (one to 'n') and at least 'percent' of
+//              their sum reached by the true variables
+//   atleast    at least 'percent' of the variables true (rounded down,
+//              thus by default 'n choose n / 2' primes)
+//   inc        most significant bit of 'x + 1' (as 'inc4msb.pol')
+//   pow        'x' is a power of two (as 'pow3.pol')
+//   prime      'x' is a prime number
+//   add        carry of adding the two halves of 'x'
+//   mul        middle bit of multiplying the two halves of 'x'
+//
+// Variable 'i' is the bit 'n - i - 1' of the minterm 'x', so minterms are
+// printed in numerical order.  The random families are deterministic for
+// the same 'seed', and 'percent' is '50' by default.
+
+static uint64_t state;
+
+static uint64_t next(void) {
+  state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+  return state >> 11;
+}
+
+static int n, percent;
+static uint64_t weights[32], threshold; // For 'threshold'.
+static int counts[33], atleast;         // For 'symmetric' and 'atleast'.
+
+static int prime(uint64_t x) {
+  if (x < 2)
+    return 0;
+  for (uint64_t d = 2; d * d <= x; d++)
+    if (!(x % d))
+      return 0;
+  return 1;
+}
+
+static int member(const char *family, uint64_t x) {
+  const int h = n / 2;
+  const uint64_t a = x >> h, b = x & (((uint64_t)1 << h) - 1);
+  if (!strcmp(family, "random"))
+    return next() % 100 < (uint64_t)percent;
+  if (!strcmp(family, "symmetric"))
+    return counts[__builtin_popcountll(x)];
+  if (!strcmp(family, "threshold")) {
+    uint64_t sum = 0;
+    for (int i = 0; i != n; i++)
+      if (x & ((uint64_t)1 << (n - i - 1)))
+        sum += weights[i];
+    return sum >= threshold;
+  }
+  if (!strcmp(family, "atleast"))
+    return __builtin_popcountll(x) >= atleast;
+  if (!strcmp(family, "inc"))
+    return (((x + 1) >> (n - 1)) & 1);
+  if (!strcmp(family, "pow"))
+    return x && !(x & (x - 1));
+  if (!strcmp(family, "prime"))
+    return prime(x);
+  if (!strcmp(family, "add"))
+    return ((a + b) >> (n - h)) & 1;
+  if (!strcmp(family, "mul"))
+    return ((a * b) >> (n / 2)) & 1;
+  return -1;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3 || argc > 5)
+    return 1;
+  const char *family = argv[1];
+  n = atoi(argv[2]);
+  if (n <= 0)
+    return 1;
+  if (n > 32)
+    return 1;
+  percent = argc > 3 ? atoi(argv[3]) : 50;
+  if (percent < 0 || percent > 100)
+    return 1;
+  state = argc > 4 ? strtoull(argv[4], 0, 10) : 0;
+  state = state * 0x9e3779b97f4a7c15ull + 1;
+  if (!strcmp(family, "cubes")) {
+    for (int j = 0; j != 4 * n; j++) {
+      for (int i = 0; i != n; i++)
+        if (next() % 100 < (uint64_t)percent)
+          fputc('-', stdout);
+        else
+          fputc('0' + (int)(next() & 1), stdout);
+      fputc('\n', stdout);
+    }
+    return 0;
+  }
+  if (!strcmp(family, "threshold")) {
+    uint64_t sum = 0;
+    for (int i = 0; i != n; i++)
+      sum += weights[i] = 1 + next() % n;
+    threshold = (sum * percent + 99) / 100;
+  }
+  if (!strcmp(family, "symmetric"))
+    for (int k = 0; k <= n; k++)
+      counts[k] = next() % 100 < (uint64_t)percent;
+  atleast = n * percent / 100;
+  const uint64_t last = ((uint64_t)1 << n) - 1;
+  uint64_t x = 0;
+  do {
+    const int res = member(family, x);
+    if (res < 0)
+      return 1;
+    if (!res)
+      continue;
+    for (int i = 0; i != n; i++)
+      fputc('0' + !!(x & ((uint64_t)1 << (n - i - 1))), stdout);
+    fputc('\n', stdout);
+  } while (x++ != last);
+  return 0;
+}
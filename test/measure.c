@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Run the given command and write its wall clock time in seconds and its
+// maximum resident set size in kilobytes to the file given as first
+// argument.  The exit status of the command is returned.
+
+int main(int argc, char **argv) {
+  if (argc < 3)
+    return 1;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  pid_t pid = fork();
+  if (pid < 0)
+    return 1;
+  if (!pid) {
+    execvp(argv[2], argv + 2);
+    _exit(127);
+  }
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid)
+    return 1;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds =
+      (end.tv_sec - start.tv_sec) + 1e-9 * (end.tv_nsec - start.tv_nsec);
+  FILE *file = fopen(argv[1], "w");
+  if (!file)
+    return 1;
+  fprintf(file, "%.3f %ld\n", seconds, usage.ru_maxrss);
+  fclose(file);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
@@ -7,14 +7,13 @@ die () {
 cd `dirname $0`/..
 
 run () {
-  [ -f ./$quienny ] || die "could not find '$quienny'"
   pol=test/$1.pol
   out=test/$1.out
   log=test/$1.log
   err=test/$1.err
   gld=test/$1.gld
-  echo "./$quienny $pol $out"
-  ./$quienny $pol $out 1>$log 2>$err
+  echo "./quienny $options $pol $out"
+  ./quienny $options $pol $out 1>$log 2>$err
   status=$?
   if [ $status = 0 ]
   then
@@ -31,8 +30,11 @@ run () {
   fi
 }
 
-for quienny in quienny quienny8 quienny16 quienny32 quienny64
+[ -f ./quienny ] || die "could not find 'quienny'"
+
+for kernel in generic 8 16 32 64 128 256 512
 do
+  options="-k $kernel"
   run empty
   run one
   run two
@@ -48,9 +50,374 @@ do
   run abo4
   run abz4
   run all4
-  case $quienny in
-    quienny8|quienny16) continue;
+  run cubes
+  case $kernel in
+    8|16) continue;
+  esac
+  run two32
+  case $kernel in
+    32|64) continue;
+  esac
+  run wide100
+done
+
+for threads in 2 3 8
+do
+  options="-t $threads"
+  run example
+  run abo4
+  run abz4
+  run all4
+  run wide100
+done
+
+for threads in 1 2 8
+do
+  for kernel in generic 64 128
+  do
+    options="--pipeline -t $threads -k $kernel"
+    run empty
+    run example
+    run cubes
+    run abo4
+    run abz4
+    run all4
+    case $kernel in
+      64) continue;
+    esac
+    run wide100
+  done
+done
+
+for mode in hash radix
+do
+  for kernel in generic 16 64 128
+  do
+    options="-n $mode -k $kernel"
+    run example
+    run abo4
+    run abz4
+    run all4
+    case $kernel in
+      16) continue;
+    esac
+    run two32
+    case $kernel in
+      64) continue;
+    esac
+    run wide100
+  done
+done
+
+for simd in none scalar avx2 avx512 neon
+do
+  ./quienny -s $simd -k 8 test/empty.pol /dev/null 2>/dev/null || continue
+  for kernel in 32 64
+  do
+    options="-s $simd -k $kernel"
+    run example
+    run abo4
+    run abz4
+    run all4
+    run two32
+  done
+done
+
+for matching in pairs lookup
+do
+  for kernel in generic 16 32 64 128
+  do
+    options="-m $matching -k $kernel"
+    run example
+    run abo4
+    run abz4
+    run all4
+    case $kernel in
+      16) continue;
+    esac
+    run two32
+    case $kernel in
+      32|64) continue;
+    esac
+    run wide100
+  done
+done
+
+for kernel in generic 16 64 128
+do
+  options="-e 1 -k $kernel"
+  run empty
+  run one
+  run example
+  run cubes
+  run abo4
+  run abz4
+  run all4
+  case $kernel in
+    16) continue;
+  esac
+  run two32
+  case $kernel in
+    64) continue;
+  esac
+  run wide100
+done
+
+for kernel in generic 8 16 64 128
+do
+  options="--consensus -k $kernel"
+  run empty
+  run one
+  run example
+  run abo4
+  run abz4
+  run all4
+  run cubes
+  case $kernel in
+    8|16) continue;
   esac
   run two32
+  case $kernel in
+    64) continue;
+  esac
+  run wide100
 done
 
+# Primes covering only don't-cares are not printed.
+
+for kernel in generic 8 16 64 128
+do
+  options="-d test/care.dc -k $kernel"
+  run care
+  options="--consensus -d test/care.dc -k $kernel"
+  run care
+done
+
+# Multi-output functions have an output column after the cube and primes
+# are shared among outputs.
+
+for options in "-k generic" "-k 8" "-k 32" "-k 128" "-t 2" "-m pairs" \
+  "-m lookup" "-n hash" "-n radix" "--pipeline -t 2"
+do
+  run adder
+done
+
+# Worker threads have to know the number of outputs too, which is only
+# noticed with enough tasks for all threads (and '--soa' storage).
+
+for options in "-t 2" "-t 8" "-t 8 -k generic" "--pipeline -t 8"
+do
+  run adder4
+done
+
+binary () {
+  bin=test/$1.bin
+  bgl=test/$1.bgl
+  gld=test/$1.gld
+  for direction in in out inout
+  do
+    case $direction in
+      in) options="--binary-in"; input=$bin; golden=$gld;;
+      out) options="--binary-out"; input=test/$1.pol; golden=$bgl;;
+      inout) options="--binary-in --binary-out"; input=$bin; golden=$bgl;;
+    esac
+    out=test/$1-$direction.out
+    log=test/$1-$direction.log
+    err=test/$1-$direction.err
+    echo "./quienny $options $input $out"
+    ./quienny $options $input $out 1>$log 2>$err || \
+      die "unexpected exit status '$?'"
+    cmp $out $golden -s 1>/dev/null 2>/dev/null || \
+      die "mismatch of '$out' and '$golden'"
+  done
+}
+
+binary example
+binary all4
+binary two32
+binary wide100
+
+# Streamed primes are only sorted within rounds, thus compare sorted lines.
+
+stream () {
+  pol=test/$1.pol
+  out=test/$1-stream.out
+  log=test/$1-stream.log
+  err=test/$1-stream.err
+  gld=test/$1.gld
+  echo "./quienny --stream $pol $out"
+  ./quienny --stream $pol $out 1>$log 2>$err || \
+    die "unexpected exit status '$?'"
+  sorted=test/$1-stream-sorted.out
+  sort $out > $sorted
+  sort $gld | cmp $sorted - -s 1>/dev/null 2>/dev/null || \
+    die "mismatch of sorted '$out' and '$gld'"
+}
+
+stream example
+stream abo4
+stream abz4
+stream all4
+stream two32
+stream wide100
+
+# Statistics should not change the output.
+
+options="--stats --stats-json test/all4-stats.log"
+run all4
+grep -q '"rounds"' test/all4-stats.log || \
+  die "no rounds in 'test/all4-stats.log'"
+
+# Every process needs more than one megabyte, thus the first round is
+# abandoned right away, no primes are written, but the state before it is
+# saved as checkpoint, which is resumed to give all primes.
+
+for limit in "" "-e 1"
+do
+  for name in example all4 two32 wide100
+  do
+    partial=test/$name-partial.out
+    out=test/$name-limit.out
+    echo "./quienny $limit --memory-limit 1 --partial $partial" \
+      "test/$name.pol $out"
+    ./quienny $limit --memory-limit 1 --partial $partial test/$name.pol $out \
+      1>test/$name-limit.log 2>test/$name-limit.err
+    status=$?
+    [ $status = 3 ] || die "unexpected exit status '$status' (expected '3')"
+    [ -s $out ] && die "unexpected primes in '$out'"
+    [ -s $partial ] || die "empty '$partial'"
+    out=test/$name-resume.out
+    echo "./quienny --resume $partial $out"
+    ./quienny --resume $partial $out 1>test/$name-resume.log \
+      2>test/$name-resume.err || die "resuming '$partial' failed"
+    cmp $out test/$name.gld -s 1>/dev/null 2>/dev/null || \
+      die "mismatch of '$out' and 'test/$name.gld'"
+  done
+done
+
+# The single cube of 'cube20' expands to a million minterms, thus its first
+# round takes seconds.  Limits have to be checked before each task also with
+# a single thread, otherwise the round is completed anyhow.
+
+start=`date +%s%N`
+echo "./quienny -t 1 --time-limit 0.2 test/cube20.pol test/cube20-limit.out"
+./quienny -t 1 --time-limit 0.2 test/cube20.pol test/cube20-limit.out \
+  1>test/cube20-limit.log 2>test/cube20-limit.err
+status=$?
+[ $status = 2 ] || die "unexpected exit status '$status' (expected '2')"
+case $start in
+  *N) ;; # No nanoseconds supported by 'date'.
+  *)
+    end=`date +%s%N`
+    milliseconds=`expr \( $end - $start \) / 1000000`
+    [ $milliseconds -lt 2000 ] || \
+      die "time limit exceeded by far (${milliseconds}ms)"
+    ;;
+esac
+
+# Expanding too large cubes fails with a parse error instead of running out
+# of memory, but iterated consensus works on the cube directly.
+
+echo "./quienny test/cube40.pol test/cube40.out"
+./quienny test/cube40.pol test/cube40.out 1>test/cube40.log 2>test/cube40.err
+status=$?
+[ $status = 1 ] || die "unexpected exit status '$status' (expected '1')"
+grep -q "try '--consensus'" test/cube40.err || \
+  die "missing hint in 'test/cube40.err'"
+echo "./quienny --consensus test/cube40.pol test/cube40.out"
+./quienny --consensus test/cube40.pol test/cube40.out \
+  1>test/cube40.log 2>test/cube40.err || die "unexpected exit status '$?'"
+cmp test/cube40.out test/cube40.pol -s 1>/dev/null 2>/dev/null || \
+  die "mismatch of 'test/cube40.out' and 'test/cube40.pol'"
+
+# The checkpoint written after the last round contains all primes, thus
+# resuming from it has to give the same primes.
+
+for name in example all4 two32 wide100
+do
+  checkpoint=test/$name-checkpoint.out
+  rm -f $checkpoint
+  options="--checkpoint $checkpoint"
+  run $name
+  [ -f $checkpoint ] || die "checkpoint '$checkpoint' missing"
+  out=test/$name-resume.out
+  echo "./quienny --resume $checkpoint $out"
+  ./quienny --resume $checkpoint $out 1>test/$name-resume.log \
+    2>test/$name-resume.err || die "resuming '$checkpoint' failed"
+  cmp $out test/$name.gld -s 1>/dev/null 2>/dev/null || \
+    die "mismatch of '$out' and 'test/$name.gld'"
+done
+
+# Covers are compared to golden '.cov' files instead of '.gld' files.
+
+cover () {
+  pol=test/$1.pol
+  out=test/$1-cover.out
+  log=test/$1-cover.log
+  err=test/$1-cover.err
+  cov=test/$1.cov
+  echo "./quienny --cover $options $pol $out"
+  ./quienny --cover $options $pol $out 1>$log 2>$err || \
+    die "unexpected exit status '$?'"
+  cmp $out $cov -s 1>/dev/null 2>/dev/null || \
+    die "mismatch of '$out' and '$cov'"
+}
+
+for kernel in generic 16 64 128
+do
+  options="-k $kernel"
+  cover example
+  cover abo4
+  cover abz4
+  cover all4
+  cover cubes
+  case $kernel in
+    16) continue;
+  esac
+  cover two32
+  case $kernel in
+    64) continue;
+  esac
+  cover wide100
+done
+
+for kernel in generic 16 64
+do
+  options="-d test/care.dc -k $kernel"
+  cover care
+done
+
+# The library engine has to give the same primes (if 'make test' built it).
+
+if [ -f test/api ]
+then
+  for name in empty example all4 cubes two32 wide100
+  do
+    echo "test/api test/$name.pol test/$name.gld"
+    test/api test/$name.pol test/$name.gld || die "library engine failed"
+  done
+fi
+
+# Functions in '--batch' mode are terminated by empty lines, and so are
+# their primes in the output.
+
+for threads in 1 2 8
+do
+  options="--batch -t $threads"
+  run batch
+  options="--batch -t $threads -k generic"
+  run batch
+done
+
+# The missing new-line at the end of the last function is an error too.
+
+for threads in 1 2
+do
+  echo "./quienny --batch -t $threads test/batchnonl.pol test/batchnonl.out"
+  ./quienny --batch -t $threads test/batchnonl.pol test/batchnonl.out \
+    1>test/batchnonl.log 2>test/batchnonl.err
+  status=$?
+  [ $status = 1 ] || die "unexpected exit status '$status' (expected '1')"
+  grep -q "unexpected end-of-file" test/batchnonl.err || \
+    die "missing parse error in 'test/batchnonl.err'"
+done
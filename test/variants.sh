@@ -0,0 +1,69 @@
+# Common part of 'bench.sh' and 'diff.sh', which source it after setting
+# 'suite' (the name of the script and its 'make' target), 'programs' (the
+# generators used) and the sweeps 'kernels', 'threads' and 'noptimize'.
+#
+# Besides the configured binary it builds the unoptimized and the structure
+# of arrays variant into 'test/$suite'.  Then 'sweep <function>' calls the
+# function for each variant, kernel and number of threads applicable to
+# polynomials over 'variables' with their options in 'run' (the unoptimized
+# variant is only run with one thread and up to 'noptimize' variables).
+# Finally 'measured <err> <command>' runs the command with 'stderr'
+# redirected to '<err>' and sets 'seconds' and 'kilobytes'.
+
+[ -f ./quienny ] || die "could not find 'quienny'"
+[ "$COMPILE" ] || \
+  die "compilation command 'COMPILE' not set (use 'make $suite')"
+for program in $programs measure
+do
+  [ -f test/$program ] || die "could not find 'test/$program'"
+done
+
+dir=test/$suite
+mkdir -p $dir || die "could not create '$dir'"
+
+cp quienny $dir/quienny-default || die "could not copy 'quienny'"
+for variant in noptimize soa
+do
+  case $variant in
+    noptimize) flags=-DNOPTIMIZE;;
+    soa) flags=-DSOA;;
+  esac
+  echo "$COMPILE $flags -o $dir/quienny-$variant quienny.cpp" 1>&2
+  $COMPILE $flags -o $dir/quienny-$variant quienny.cpp || \
+    die "compiling '$variant' variant failed"
+done
+
+sweep () {
+  for variant in default soa noptimize
+  do
+    if [ $variant = noptimize ]
+    then
+      [ $variables -le $noptimize ] || continue
+    fi
+    for kernel in $kernels
+    do
+      if [ $kernel = default ]
+      then
+        options=""
+      else
+        [ $kernel = generic ] || [ $variables -le $kernel ] || continue
+        options="-k $kernel"
+      fi
+      for t in $threads
+      do
+        [ $variant = noptimize ] && [ $t != 1 ] && continue
+        run="$options"
+        [ $t = 1 ] || run="$run -t $t"
+        $1
+      done
+    done
+  done
+}
+
+measured () {
+  log=$1
+  shift
+  echo "$*" 1>&2
+  test/measure $dir/measure.log "$@" 2>$log || die "'$*' failed"
+  read seconds kilobytes < $dir/measure.log
+}